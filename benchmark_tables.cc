@@ -0,0 +1,235 @@
+/**
+ * @file benchmark_tables.cc
+ * @author Moody Rahman
+ * @brief
+ * @version 0.1
+ * @date 2021-11-03
+ *
+ * microbenchmark of the hash table variants: times Insert, successful Get,
+ * unsuccessful lookups, Remove and Rehash across key counts and load
+ * factors, and writes one CSV row per (table, operation, keys, load factor)
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "quadratic_probing.h"
+#include "linear_probing.h"
+#include "double_hashing.h"
+#include "robin_hood_hashing.h"
+#include "group_probing.h"
+#include "cuckoo_hashing.h"
+
+using namespace std;
+
+// Nominal key counts and target load factors benchmarked. 0.5 is the
+// highest load the linear, quadratic and double tables reach before they
+// rehash.
+const size_t kKeyCounts[] = {1000, 10000, 100000};
+const double kLoadFactors[] = {0.25, 0.375, 0.5};
+
+// Keeps the compiler from discarding lookups whose results are unused.
+volatile size_t benchmark_sink = 0;
+
+// @count: how many keys to make
+// @salt: keys made with different salts never collide
+// Returns count distinct words of 6 to 12 letters; the letters come from a
+// splitmix64 sequence so the keys look random to the hash functions.
+vector<string> MakeKeys(size_t count, uint64_t salt)
+{
+    vector<string> keys;
+    keys.reserve(count);
+    for (uint64_t x = 0; x < count; x++)
+    {
+        uint64_t state = (x << 8 | salt) * UINT64_C(0x9e3779b97f4a7c15);
+        state = (state ^ (state >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+        state = (state ^ (state >> 27)) * UINT64_C(0x94d049bb133111eb);
+        state ^= state >> 31;
+        string key(1, static_cast<char>('a' + salt % 26));
+        for (size_t length = 5 + state % 7; length > 0; length--)
+        {
+            key += static_cast<char>('a' + state % 26);
+            state /= 26;
+        }
+        // The index keeps keys unique whatever the letters came out as.
+        key += to_string(x);
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+// The nanoseconds per operation of each timed trial of one operation.
+struct Timings
+{
+    vector<double> ns_per_op;
+
+    void Add(chrono::steady_clock::time_point start, size_t operations)
+    {
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        ns_per_op.push_back(ns / max<size_t>(operations, 1));
+    }
+
+    double Median() const
+    {
+        vector<double> sorted = ns_per_op;
+        sort(sorted.begin(), sorted.end());
+        size_t middle = sorted.size() / 2;
+        return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+    }
+
+    double Min() const
+    {
+        return *min_element(ns_per_op.begin(), ns_per_op.end());
+    }
+};
+
+// @out: CSV output
+// @slots: the table's slot count during the operation; for rehash, the slot
+// count it was rehashed into
+// Writes one row for an operation of a table.
+void WriteRow(ostream &out, const string &table_name, const string &operation,
+              size_t keys, double target_load, double load_factor, size_t slots,
+              const Timings &timings)
+{
+    double median = timings.Median();
+    out << table_name << "," << operation << "," << keys << "," << target_load
+        << "," << load_factor << "," << slots << "," << timings.ns_per_op.size() << "," << median
+        << "," << timings.Min() << "," << 1e9 / median << "\n";
+}
+
+// @make_table: returns an empty table with at least capacity slots
+// @table_name: label written in the CSV
+// @key_count: nominal number of keys
+// @all_keys: at least 2 * key_count keys to insert, look up and remove
+// @all_misses: as many keys that are never inserted
+// @target_load: load factor to fill the table to
+// @trials: timed trials, after one untimed warmup trial
+// Benchmarks one table at one key count and load factor. Each trial builds
+// a fresh table with room for key_count keys at target_load. Tables round
+// their size up (to a prime or a power of two), so target_load times the
+// actual size is inserted, which is key_count to 2 * key_count keys, and
+// no insert rehashes.
+template <typename MakeTable>
+void BenchmarkTable(ostream &out, MakeTable make_table, const string &table_name,
+                    size_t key_count, const vector<string> &all_keys,
+                    const vector<string> &all_misses, double target_load, int trials)
+{
+    Timings insert, get_hit, get_miss, remove, rehash;
+    double load_factor = 0;
+    size_t slots = 0, grown_slots = 0;
+    vector<string> keys, misses;
+    for (int trial = 0; trial <= trials; trial++)
+    {
+        // The first trial warms the caches and the allocator and is dropped.
+        bool timed = trial > 0;
+        auto table = make_table(key_count / target_load);
+        if (!timed)
+        {
+            size_t count = min(all_keys.size(), size_t(target_load * table.InternalSize()));
+            keys.assign(all_keys.begin(), all_keys.begin() + count);
+            misses.assign(all_misses.begin(), all_misses.begin() + count);
+        }
+        auto start = chrono::steady_clock::now();
+        for (const string &key : keys)
+            table.Insert(key);
+        if (timed)
+            insert.Add(start, keys.size());
+        slots = table.InternalSize();
+        load_factor = table.TotalElements() / (double)slots;
+
+        // Get reports a miss by throwing, so misses are timed with Find.
+        size_t probes = 0;
+        start = chrono::steady_clock::now();
+        for (const string &key : keys)
+            probes += table.Get(key);
+        if (timed)
+            get_hit.Add(start, keys.size());
+
+        start = chrono::steady_clock::now();
+        for (const string &miss : misses)
+            probes += table.Find(miss).found;
+        if (timed)
+            get_miss.Add(start, misses.size());
+        benchmark_sink = benchmark_sink + probes;
+
+        // Growing to (at least) twice the slots rehashes every key. A copy
+        // is grown so that the removes below run at load_factor too.
+        auto grown = table;
+        size_t elements = grown.TotalElements();
+        start = chrono::steady_clock::now();
+        grown.ReserveSlots(2 * slots);
+        if (timed)
+            rehash.Add(start, elements);
+        grown_slots = grown.InternalSize();
+
+        start = chrono::steady_clock::now();
+        for (const string &key : keys)
+            table.Remove(key);
+        if (timed)
+            remove.Add(start, keys.size());
+    }
+
+    WriteRow(out, table_name, "insert", keys.size(), target_load, load_factor, slots, insert);
+    WriteRow(out, table_name, "get_hit", keys.size(), target_load, load_factor, slots, get_hit);
+    WriteRow(out, table_name, "get_miss", keys.size(), target_load, load_factor, slots, get_miss);
+    WriteRow(out, table_name, "remove", keys.size(), target_load, load_factor, slots, remove);
+    WriteRow(out, table_name, "rehash", keys.size(), target_load, load_factor, grown_slots, rehash);
+}
+
+// @out: CSV output
+// @trials: timed trials per measurement
+// Runs every table at every key count and load factor.
+void BenchmarkTables(ostream &out, int trials)
+{
+    out << "table,operation,keys,target_load,load_factor,slots,trials,ns_per_op_median,ns_per_op_min,ops_per_sec\n";
+    for (size_t key_count : kKeyCounts)
+    {
+        const vector<string> keys = MakeKeys(2 * key_count, 1);
+        const vector<string> misses = MakeKeys(2 * key_count, 2);
+        for (double target_load : kLoadFactors)
+        {
+            BenchmarkTable(out, [](size_t capacity) { return HashTableLinear<string>(capacity); },
+                           "linear", key_count, keys, misses, target_load, trials);
+            BenchmarkTable(out, [](size_t capacity) { return HashTable<string>(capacity); },
+                           "quadratic", key_count, keys, misses, target_load, trials);
+            BenchmarkTable(out, [](size_t capacity) { return HashTableDouble<string>(89, capacity); },
+                           "double", key_count, keys, misses, target_load, trials);
+            BenchmarkTable(out, [](size_t capacity) { return HashTableRobinHood<string>(capacity); },
+                           "robinhood", key_count, keys, misses, target_load, trials);
+            BenchmarkTable(out, [](size_t capacity) { return HashTableSwiss<string>(capacity); },
+                           "swiss", key_count, keys, misses, target_load, trials);
+            BenchmarkTable(out, [](size_t capacity) { return HashTableCuckoo<string>(capacity); },
+                           "cuckoo", key_count, keys, misses, target_load, trials);
+            out.flush();
+        }
+    }
+}
+
+// Writes the benchmark CSV to the file named by the first argument, or to
+// standard output; the optional second argument is the number of trials.
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        cout << "Usage: " << argv[0] << " [csv-file] [trials]" << endl;
+        return 0;
+    }
+    int trials = argc == 3 ? max(1, stoi(argv[2])) : 5;
+    if (argc >= 2)
+    {
+        ofstream csv(argv[1]);
+        BenchmarkTables(csv, trials);
+    }
+    else
+    {
+        BenchmarkTables(cout, trials);
+    }
+    return 0;
+}
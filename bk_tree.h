@@ -0,0 +1,316 @@
+/**
+ * @file bk_tree.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for BKTree, a
+ *        metric tree answering "closest words" queries at any edit distance
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Each node holds one dictionary word, and a child hangs off its parent by the
+ * DamerauDistance between the two. Since that distance obeys the triangle
+ * inequality, a search for words within t of a query that is d away from a
+ * node only has to descend into children whose edge lies in [d - t, d + t].
+ * Unlike enumerating candidate spellings, whose number grows exponentially
+ * with the distance searched, the cost of a search grows with the fraction of
+ * the tree inside that band, so long or badly mangled words can still be
+ * matched at distance 3 or more.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef BK_TREE_H
+#define BK_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "edit_distance.h"
+#include "string_arena.h"
+
+class BKTree
+{
+public:
+  /**
+   * @brief Construct a new BKTree object from the words in [first, last)
+   *
+   * @param first
+   * @param last
+   */
+  template <typename InputIt>
+  BKTree(InputIt first, InputIt last)
+  {
+    for (; first != last; ++first)
+      Insert(*first);
+  }
+
+  BKTree(const BKTree &) = delete;
+  BKTree &operator=(const BKTree &) = delete;
+
+  /**
+   * @brief adds word to the tree, unless it is already present
+   *
+   * @param word
+   * @return true
+   * @return false if word was already present
+   */
+  bool Insert(std::string_view word)
+  {
+    if (nodes_.empty())
+    {
+      nodes_.push_back(Node{arena_.Store(word), kNone, kNone, 0, 0});
+      return true;
+    }
+
+    uint32_t current = 0;
+    for (;;)
+    {
+      int distance = DamerauDistance(word, nodes_[current].word, kUnbounded);
+      if (distance == 0)
+        return false;
+      uint32_t child = FindChild(current, distance);
+      if (child == kNone)
+      {
+        nodes_.push_back(Node{arena_.Store(word), kNone, nodes_[current].first_child, distance, 0});
+        nodes_[current].first_child = nodes_.size() - 1;
+        nodes_[current].max_child_distance = std::max(nodes_[current].max_child_distance, distance);
+        return true;
+      }
+      current = child;
+    }
+  }
+
+  /**
+   * @brief returns every word within max_distance edits of word, closest
+   *        first. Distances here and in Closest are DamerauDistance.
+   *
+   * @param word
+   * @param max_distance
+   * @return std::vector<Suggestion>
+   */
+  std::vector<Suggestion> Search(std::string_view word, int max_distance) const
+  {
+    std::vector<Match> matches;
+    Collect(word, max_distance, matches);
+    return ToSuggestions(matches, matches.size());
+  }
+
+  /**
+   * @brief returns the count words closest to word, and no further than
+   *        max_distance edits away, closest first. Ties at the cut-off
+   *        distance are broken by insertion order.
+   *
+   * @param word
+   * @param count
+   * @param max_distance
+   * @return std::vector<Suggestion>
+   */
+  std::vector<Suggestion> Closest(std::string_view word, size_t count, int max_distance) const
+  {
+    std::vector<Match> matches;
+    if (nodes_.empty() || count == 0)
+      return {};
+
+    // The search radius starts at max_distance and shrinks to the distance
+    // of the count-th best match once there are count of them, which are
+    // kept in a max-heap.
+    int radius = max_distance;
+    std::vector<uint32_t> pending{0};
+    while (!pending.empty())
+    {
+      uint32_t current = pending.back();
+      pending.pop_back();
+      int distance = DamerauDistance(word, nodes_[current].word,
+                                     radius + nodes_[current].max_child_distance);
+      if (distance <= radius)
+      {
+        matches.push_back(Match{distance, current});
+        std::push_heap(matches.begin(), matches.end());
+        if (matches.size() > count)
+        {
+          std::pop_heap(matches.begin(), matches.end());
+          matches.pop_back();
+        }
+        if (matches.size() == count)
+          radius = matches.front().distance;
+      }
+      for (uint32_t child = nodes_[current].first_child; child != kNone;
+           child = nodes_[child].next_sibling)
+      {
+        if (std::abs(nodes_[child].distance - distance) <= radius)
+          pending.push_back(child);
+      }
+    }
+    return ToSuggestions(matches, count);
+  }
+
+  /**
+   * @brief returns every dictionary word within max_distance edits of typo,
+   *        closest first, measured and labelled like SuggestionIndex::Suggest.
+   *        Every word within EditDistance max_distance is also within
+   *        DamerauDistance max_distance, so Search finds them all.
+   *
+   * @param typo
+   * @param max_distance
+   * @return std::vector<Suggestion>
+   */
+  std::vector<Suggestion> Suggest(std::string_view typo, int max_distance = 2) const
+  {
+    std::vector<Suggestion> suggestions;
+    for (Suggestion suggestion : Search(typo, max_distance))
+    {
+      suggestion.distance = EditDistance(typo, suggestion.word, max_distance);
+      if (suggestion.distance == 0 || suggestion.distance > max_distance)
+        continue;
+      if (suggestion.distance == 1)
+        suggestion.type = EditCase(typo, suggestion.word);
+      suggestions.push_back(suggestion);
+    }
+    SortSuggestions(suggestions);
+    return suggestions;
+  }
+
+  /**
+   * @brief returns the number of words in the tree
+   *
+   * @return size_t
+   */
+  size_t TotalWords() const
+  {
+    return nodes_.size();
+  }
+
+  /**
+   * @brief returns the depth of the deepest node; the root is at depth 1
+   *
+   * @return int
+   */
+  int Depth() const
+  {
+    int depth = 0;
+    std::vector<std::pair<uint32_t, int>> pending;
+    if (!nodes_.empty())
+      pending.emplace_back(0, 1);
+    while (!pending.empty())
+    {
+      auto [current, level] = pending.back();
+      pending.pop_back();
+      depth = std::max(depth, level);
+      for (uint32_t child = nodes_[current].first_child; child != kNone;
+           child = nodes_[child].next_sibling)
+        pending.emplace_back(child, level + 1);
+    }
+    return depth;
+  }
+
+private:
+  static const uint32_t kNone = UINT32_MAX;
+  // Passed to EditDistance when the exact distance is needed.
+  static const int kUnbounded = std::numeric_limits<int>::max() / 2;
+
+  /**
+   * @brief one word; its children form a singly linked list
+   *
+   */
+  struct Node
+  {
+    std::string_view word;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    // Edit distance to the parent.
+    int distance;
+    // Longest edge to a child.
+    int max_child_distance;
+  };
+
+  /**
+   * @brief a search result; orders by distance, then by node, so equally
+   *        close words keep their insertion order
+   *
+   */
+  struct Match
+  {
+    int distance;
+    uint32_t node;
+
+    bool operator<(const Match &other) const
+    {
+      return distance != other.distance ? distance < other.distance : node < other.node;
+    }
+  };
+
+  StringArena arena_;
+  std::vector<Node> nodes_;
+
+  /**
+   * @brief appends every word within radius of word to matches
+   *
+   * @param word
+   * @param radius
+   * @param matches
+   */
+  void Collect(std::string_view word, int radius, std::vector<Match> &matches) const
+  {
+    if (nodes_.empty())
+      return;
+    std::vector<uint32_t> pending{0};
+    while (!pending.empty())
+    {
+      uint32_t current = pending.back();
+      pending.pop_back();
+      // Past radius + the longest edge, neither this word nor any child can
+      // be in range, so the exact distance isn't needed.
+      int distance = DamerauDistance(word, nodes_[current].word,
+                                     radius + nodes_[current].max_child_distance);
+      if (distance <= radius)
+        matches.push_back(Match{distance, current});
+      for (uint32_t child = nodes_[current].first_child; child != kNone;
+           child = nodes_[child].next_sibling)
+      {
+        if (std::abs(nodes_[child].distance - distance) <= radius)
+          pending.push_back(child);
+      }
+    }
+  }
+
+  /**
+   * @brief returns the count closest of matches as suggestions, closest first
+   *
+   * @param matches
+   * @param count
+   * @return std::vector<Suggestion>
+   */
+  std::vector<Suggestion> ToSuggestions(std::vector<Match> &matches, size_t count) const
+  {
+    std::sort(matches.begin(), matches.end());
+    matches.resize(std::min(count, matches.size()));
+    std::vector<Suggestion> suggestions;
+    for (const Match &match : matches)
+      suggestions.push_back(Suggestion{nodes_[match.node].word, match.distance, 0});
+    return suggestions;
+  }
+
+  /**
+   * @brief returns the child of parent whose edge is distance, or kNone
+   *
+   * @param parent
+   * @param distance
+   * @return uint32_t
+   */
+  uint32_t FindChild(uint32_t parent, int distance) const
+  {
+    for (uint32_t child = nodes_[parent].first_child; child != kNone;
+         child = nodes_[child].next_sibling)
+    {
+      if (nodes_[child].distance == distance)
+        return child;
+    }
+    return kNone;
+  }
+};
+
+#endif // BK_TREE_H
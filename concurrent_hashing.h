@@ -0,0 +1,475 @@
+/**
+ * @file concurrent_hashing.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for
+ *        HashTableConcurrent (linear probing that many threads can insert
+ *        into and look up in at once)
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Every slot carries an atomic state, EMPTY -> BUSY -> ACTIVE. An inserter
+ * claims an empty slot with a compare-and-swap, writes the element and
+ * publishes it by storing ACTIVE; a lookup never writes and only waits on a
+ * slot that is BUSY, i.e. in the middle of being written.
+ *
+ * Growing is cooperative. The thread that finds the table half full raises
+ * resizing_, waits for in-flight inserts to leave, and allocates the next
+ * array; every inserter that arrives meanwhile helps copy chunks of the old
+ * array across instead of blocking. Lookups keep reading the old array until
+ * the new one is swapped in, which is safe because inserts are held off for
+ * the whole migration and arrays are not freed until MakeEmpty() or the
+ * table's destruction.
+ *
+ * The table only grows: there is no Remove.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CONCURRENT_HASHING_H
+#define CONCURRENT_HASHING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "size_policy.h"
+
+template <typename HashedObj, typename Hasher = std::hash<HashedObj>>
+class HashTableConcurrent
+{
+public:
+  enum EntryType : uint8_t
+  {
+    EMPTY,
+    BUSY,
+    ACTIVE
+  };
+
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
+  /**
+   * @brief Construct a new Hash Table Concurrent object
+   *
+   * @param size
+   */
+  explicit HashTableConcurrent(size_t size = 101)
+  {
+    arrays_.emplace_back(new SlotArray(size));
+    current_.store(arrays_.back().get());
+  }
+
+  /**
+   * @brief Construct a new Hash Table Concurrent object sized once for the
+   *        range [first, last) and filled from it
+   *
+   * @param first
+   * @param last
+   */
+  template <typename ForwardIt,
+            typename = typename std::enable_if<!std::is_integral<ForwardIt>::value>::type>
+  HashTableConcurrent(ForwardIt first, ForwardIt last)
+      : HashTableConcurrent(2 * std::distance(first, last) + 1)
+  {
+    for (; first != last; ++first)
+      Insert(*first);
+  }
+
+  HashTableConcurrent(const HashTableConcurrent &) = delete;
+  HashTableConcurrent &operator=(const HashTableConcurrent &) = delete;
+
+  /**
+   * @brief returns if x is in this HashTable object. Safe to call alongside
+   *        any other Contains, Find or Insert.
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Contains(const HashedObj &x) const
+  {
+    return Find(x).found;
+  }
+
+  /**
+   * @brief deletes all entries and frees every array. Not safe to call while
+   *        other threads use the table.
+   *
+   */
+  void MakeEmpty()
+  {
+    size_t size = InternalSize();
+    arrays_.clear();
+    arrays_.emplace_back(new SlotArray(size));
+    current_.store(arrays_.back().get());
+    current_size_.store(0);
+    collisions_.store(0);
+  }
+
+  /**
+   * @brief size the table once so that n elements fit without growing. Not
+   *        safe to call while other threads use the table.
+   *
+   * @param n
+   */
+  void Reserve(size_t n)
+  {
+    SlotArray *array = current_.load();
+    if (2 * n + 1 > array->capacity_)
+      MigrateTo(array, 2 * n + 1);
+  }
+
+  /**
+   * @brief look up in without throwing; reports the probes taken whether or
+   *        not it was found. Safe to call alongside any other Contains, Find
+   *        or Insert.
+   *
+   * @param in
+   * @return LookupResult
+   */
+  LookupResult Find(const HashedObj &in) const
+  {
+    int probes;
+    bool found = FindPos(*current_.load(), in, Hash(in), probes) != kNotFound;
+    return LookupResult{found, probes};
+  }
+
+  /**
+   * @brief insert x into the table, unless it is already present. Safe to call
+   *        alongside any other Contains, Find or Insert.
+   *
+   * @param x
+   * @return true
+   * @return false if x was already present
+   */
+  bool Insert(const HashedObj &x)
+  {
+    size_t hash = Hash(x);
+    for (;;)
+    {
+      EnterInsert();
+      SlotArray *array = current_.load();
+      if (current_size_.load() >= array->capacity_ / 2)
+      {
+        LeaveInsert();
+        Grow(array);
+        continue;
+      }
+
+      int probes;
+      ClaimResult result = Claim(*array, x, hash, probes);
+      LeaveInsert();
+      if (result == kFull)
+      {
+        // More threads raced past the half-full check than the table had
+        // spare slots; grow and try again.
+        Grow(array);
+        continue;
+      }
+      collisions_.fetch_add(probes - 1, std::memory_order_relaxed);
+      if (result == kPresent)
+        return false;
+      current_size_.fetch_add(1);
+      return true;
+    }
+  }
+
+  /**
+   * @brief return total collisions that occured while inserting. Copies made
+   *        while growing are not counted.
+   *
+   * @return int
+   */
+  int TotalCollisions() const
+  {
+    return collisions_.load();
+  }
+
+  /**
+   * @brief returns total elements in HashTable
+   *
+   * @return int
+   */
+  int TotalElements() const
+  {
+    return current_size_.load();
+  }
+
+  /**
+   * @brief returns internal HashTable allocated size
+   *
+   * @return int
+   */
+  int InternalSize() const
+  {
+    return current_.load()->capacity_;
+  }
+
+private:
+  enum ClaimResult
+  {
+    kInserted,
+    kPresent,
+    kFull
+  };
+
+  // Slots copied per unit of work while growing.
+  static const size_t kChunkSize = 1024;
+  static const size_t kNotFound = SIZE_MAX;
+
+  struct Slot
+  {
+    std::atomic<uint8_t> info_{EMPTY};
+    size_t hash_ = 0;
+    HashedObj element_{};
+  };
+
+  /**
+   * @brief one array of slots, along with the state of migrating it into its
+   *        successor once it fills up
+   *
+   */
+  struct SlotArray
+  {
+    explicit SlotArray(size_t size)
+        : capacity_(policy_.Resize(size)), slots_(new Slot[capacity_]),
+          chunk_count_((capacity_ + kChunkSize - 1) / kChunkSize)
+    {
+    }
+
+    PowerOfTwoSizePolicy policy_;
+    size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t chunk_count_;
+    std::atomic<SlotArray *> next_{nullptr};
+    std::atomic<size_t> next_chunk_{0};
+    std::atomic<size_t> chunks_done_{0};
+  };
+
+  // Every array the table has used; only the last is current.
+  std::vector<std::unique_ptr<SlotArray>> arrays_;
+  std::atomic<SlotArray *> current_{nullptr};
+  std::atomic<bool> resizing_{false};
+  std::atomic<int> inserters_{0};
+  std::atomic<size_t> current_size_{0};
+  std::atomic<size_t> collisions_{0};
+
+  /**
+   * @brief returns the position of x in array, or kNotFound. Waits out any
+   *        slot that is still being written.
+   *
+   * @param array
+   * @param x
+   * @param hash Hash(x)
+   * @param probes set to the number of slots examined
+   * @return size_t
+   */
+  static size_t FindPos(const SlotArray &array, const HashedObj &x, size_t hash,
+                        int &probes)
+  {
+    size_t mask = array.capacity_ - 1;
+    size_t current_pos = array.policy_.Index(hash);
+    for (probes = 1;; probes++)
+    {
+      const Slot &slot = array.slots_[current_pos];
+      uint8_t info = WaitWhileBusy(slot);
+      if (info == EMPTY)
+        return kNotFound;
+      if (slot.hash_ == hash && slot.element_ == x)
+        return current_pos;
+      current_pos = (current_pos + 1) & mask;
+    }
+  }
+
+  /**
+   * @brief stores x in the first empty slot of its probe sequence, unless x
+   *        is found first
+   *
+   * @param array
+   * @param x
+   * @param hash Hash(x)
+   * @param probes set to the number of slots examined
+   * @return ClaimResult kFull if every slot was taken
+   */
+  static ClaimResult Claim(SlotArray &array, const HashedObj &x, size_t hash,
+                           int &probes)
+  {
+    size_t mask = array.capacity_ - 1;
+    size_t current_pos = array.policy_.Index(hash);
+    for (probes = 1; static_cast<size_t>(probes) <= array.capacity_; probes++)
+    {
+      Slot &slot = array.slots_[current_pos];
+      uint8_t info = slot.info_.load(std::memory_order_acquire);
+      if (info == EMPTY &&
+          slot.info_.compare_exchange_strong(info, BUSY, std::memory_order_acquire))
+      {
+        slot.element_ = x;
+        slot.hash_ = hash;
+        slot.info_.store(ACTIVE, std::memory_order_release);
+        return kInserted;
+      }
+      // Lost the race, or the slot was never empty; a duplicate of x could be
+      // sitting in it, so let its writer finish and compare.
+      if (info == BUSY)
+        info = WaitWhileBusy(slot);
+      if (slot.hash_ == hash && slot.element_ == x)
+        return kPresent;
+      current_pos = (current_pos + 1) & mask;
+    }
+    return kFull;
+  }
+
+  /**
+   * @brief returns the state of slot once it is no longer BUSY
+   *
+   * @param slot
+   * @return uint8_t
+   */
+  static uint8_t WaitWhileBusy(const Slot &slot)
+  {
+    uint8_t info;
+    while ((info = slot.info_.load(std::memory_order_acquire)) == BUSY)
+      std::this_thread::yield();
+    return info;
+  }
+
+  /**
+   * @brief registers the calling thread as inserting into the current array,
+   *        helping with any migration in progress first
+   *
+   */
+  void EnterInsert()
+  {
+    for (;;)
+    {
+      if (resizing_.load())
+      {
+        HelpResize();
+        continue;
+      }
+      inserters_.fetch_add(1);
+      if (!resizing_.load())
+        return;
+      inserters_.fetch_sub(1);
+    }
+  }
+
+  void LeaveInsert()
+  {
+    inserters_.fetch_sub(1);
+  }
+
+  /**
+   * @brief copies chunks of the array being migrated, if any, then waits for
+   *        the migration to finish
+   *
+   */
+  void HelpResize()
+  {
+    while (resizing_.load())
+    {
+      SlotArray *from = current_.load();
+      SlotArray *to = from->next_.load();
+      if (to != nullptr)
+        MigrateChunks(*from, *to);
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * @brief grows the table past from, unless another thread already has or is
+   *        doing so, in which case this one helps
+   *
+   * @param from the array the caller found full
+   */
+  void Grow(SlotArray *from)
+  {
+    bool expected = false;
+    if (current_.load() != from || !resizing_.compare_exchange_strong(expected, true))
+    {
+      HelpResize();
+      return;
+    }
+    if (current_.load() != from)
+    {
+      // Another thread grew it between our check and the exchange.
+      resizing_.store(false);
+      return;
+    }
+    while (inserters_.load() != 0)
+      std::this_thread::yield();
+    MigrateTo(from, 2 * from->capacity_);
+    resizing_.store(false);
+  }
+
+  /**
+   * @brief allocates an array of at least min_size slots, copies from into it
+   *        alongside any helping threads, and makes it current. Inserts must
+   *        already be held off.
+   *
+   * @param from
+   * @param min_size
+   */
+  void MigrateTo(SlotArray *from, size_t min_size)
+  {
+    arrays_.emplace_back(new SlotArray(min_size));
+    SlotArray *to = arrays_.back().get();
+    from->next_.store(to);
+    MigrateChunks(*from, *to);
+    while (from->chunks_done_.load() != from->chunk_count_)
+      std::this_thread::yield();
+    current_.store(to);
+  }
+
+  /**
+   * @brief claims chunks of from until none are left, copying their elements
+   *        into to. from is left intact for lookups still reading it.
+   *
+   * @param from
+   * @param to
+   */
+  static void MigrateChunks(SlotArray &from, SlotArray &to)
+  {
+    for (size_t chunk = from.next_chunk_++; chunk < from.chunk_count_;
+         chunk = from.next_chunk_++)
+    {
+      size_t end = std::min(from.capacity_, (chunk + 1) * kChunkSize);
+      for (size_t pos = chunk * kChunkSize; pos < end; pos++)
+      {
+        const Slot &slot = from.slots_[pos];
+        int probes;
+        if (slot.info_.load(std::memory_order_acquire) == ACTIVE)
+          Claim(to, slot.element_, slot.hash_, probes);
+      }
+      from.chunks_done_++;
+    }
+  }
+
+  static size_t Hash(const HashedObj &x)
+  {
+    static Hasher hf;
+    return hf(x);
+  }
+};
+
+#endif // CONCURRENT_HASHING_H
@@ -10,14 +10,26 @@
  * @copyright Copyright (c) 2021
  * 
  */
+#include <charconv>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 
 #include "quadratic_probing.h"
 #include "linear_probing.h"
 #include "double_hashing.h"
+#include "robin_hood_hashing.h"
+#include "group_probing.h"
+#include "cuckoo_hashing.h"
+#include "string_hashers.h"
+#include "string_arena.h"
+#include "concurrent_hashing.h"
+#include "report_writer.h"
 
 using namespace std;
 
@@ -40,27 +52,392 @@ void TestFunctionForHashTable(HashTableType &hash_table,
         hash_table.Insert(line);
     }
 
-    std::cout << "number_of_elements: " << hash_table.TotalElements() << std::endl;
-    std::cout << "size_of_table: " << hash_table.InternalSize() << std::endl;
-    std::cout << "load_factor: " << hash_table.TotalElements() / (float)hash_table.InternalSize() << std::endl;
-    std::cout << "average_collisions: " << hash_table.TotalCollisions() / (float)hash_table.TotalElements() << std::endl;
-    std::cout << "total_collisions: " << hash_table.TotalCollisions() << std::endl;
-
-    std::cout << std::endl;
+    ReportWriter out(std::cout, ReportOptions::FromEnvironment());
+    out.Stat("number_of_elements", hash_table.TotalElements());
+    out.Stat("size_of_table", hash_table.InternalSize());
+    out.Stat("load_factor", hash_table.TotalElements() / (float)hash_table.InternalSize());
+    out.Stat("average_collisions", hash_table.TotalCollisions() / (float)hash_table.TotalElements());
+    out.Stat("total_collisions", hash_table.TotalCollisions());
+    out.EndSection();
     
+    // Look the queries up as one batch so the table can overlap their cache
+    // misses.
+    vector<string> queries;
+    while (qfile >> line)
+    {
+        queries.push_back(line);
+    }
+    vector<decltype(hash_table.Find(line))> results(queries.size());
+    hash_table.FindBatch(queries.begin(), queries.end(), results.begin());
+
+    for (size_t x = 0; x < queries.size(); x++)
+    {
+        out.Lookup(queries[x], results[x].found, results[x].probes);
+    }
+
+}
+
+// @hasher_name: label printed for the hash function under test
+// @table_name: label printed for the table type under test
+// @hash_table: an empty hash table using that hash function
+// @words: words to insert and then look up
+// @queries: words to look up after the inserts
+// Prints one row of the hasher comparison: collisions during the inserts,
+// and insert and lookup throughput in millions of operations per second.
+template <typename HashTableType>
+void CompareHasher(const string &hasher_name, const string &table_name,
+                   HashTableType &hash_table, const vector<string> &words,
+                   const vector<string> &queries)
+{
+    auto start = chrono::steady_clock::now();
+    for (const string &word : words)
+        hash_table.Insert(word);
+    auto inserted = chrono::steady_clock::now();
+    int insert_collisions = hash_table.TotalCollisions();
+
+    size_t found = 0;
+    for (const string &word : words)
+        found += hash_table.Find(word).found;
+    for (const string &query : queries)
+        found += hash_table.Find(query).found;
+    auto looked_up = chrono::steady_clock::now();
+
+    double insert_seconds = chrono::duration<double>(inserted - start).count();
+    double lookup_seconds = chrono::duration<double>(looked_up - inserted).count();
+    std::cout << hasher_name << "\t" << table_name
+              << "\t" << insert_collisions
+              << "\t" << insert_collisions / (float)words.size()
+              << "\t" << words.size() / insert_seconds / 1e6
+              << "\t" << (words.size() + queries.size()) / lookup_seconds / 1e6
+              << std::endl;
+}
+
+// @hasher_name: label printed for the hash function
+// Runs CompareHasher for the linear, quadratic and double tables with Hasher.
+template <typename Hasher>
+void CompareHasherAcrossTables(const string &hasher_name, int r_value,
+                               const vector<string> &words,
+                               const vector<string> &queries)
+{
+    HashTableLinear<string, PrimeSizePolicy, Hasher> linear_probing_table;
+    CompareHasher(hasher_name, "linear", linear_probing_table, words, queries);
+    HashTable<string, PrimeSizePolicy, Hasher> quadratic_probing_table;
+    CompareHasher(hasher_name, "quadratic", quadratic_probing_table, words, queries);
+    HashTableDouble<string, PrimeSizePolicy, Hasher> double_probing_table(r_value, 101);
+    CompareHasher(hasher_name, "double", double_probing_table, words, queries);
+}
+
+// @words_filename: a filename of input words to construct the hash tables
+// @query_filename: a filename of input words to look up afterwards
+// Compares the built-in string hashers on every probing scheme.
+void CompareHashers(const string &words_filename, const string &query_filename,
+                    int r_value)
+{
+    fstream wfile(words_filename);
+    fstream qfile(query_filename);
+    vector<string> words, queries;
+    string line;
+    while (wfile >> line)
+        words.push_back(line);
     while (qfile >> line)
+        queries.push_back(line);
+
+    std::cout << "hasher\ttable\ttotal_collisions\taverage_collisions"
+              << "\tinsert_mops\tlookup_mops" << std::endl;
+    CompareHasherAcrossTables<std::hash<string>>("std", r_value, words, queries);
+    CompareHasherAcrossTables<Fnv1aHash>("fnv1a", r_value, words, queries);
+    CompareHasherAcrossTables<WyHash>("wyhash", r_value, words, queries);
+}
+
+// @policy_name: label printed for the growth policy under test
+// @table_name: label printed for the table type under test
+// @hash_table: an empty hash table
+// @words: words to insert, then look up as hits
+// @misses: words that are never inserted
+// Prints one row of the growth policy comparison: the memory the table
+// ended up with, the time per insert and per lookup, and the probes the
+// lookups took.
+template <typename HashTableType>
+void CompareGrowth(const string &policy_name, const string &table_name,
+                   HashTableType &hash_table, const GrowthPolicy &policy,
+                   const vector<string> &words, const vector<string> &misses)
+{
+    hash_table.SetGrowthPolicy(policy);
+    auto start = chrono::steady_clock::now();
+    for (const string &word : words)
+        hash_table.Insert(word);
+    auto inserted = chrono::steady_clock::now();
+
+    size_t hit_probes = 0, miss_probes = 0;
+    int max_hit_probes = 0;
+    for (const string &word : words)
+    {
+        auto result = hash_table.Find(word);
+        hit_probes += result.probes;
+        max_hit_probes = max(max_hit_probes, result.probes);
+    }
+    for (const string &miss : misses)
+        miss_probes += hash_table.Find(miss).probes;
+    auto looked_up = chrono::steady_clock::now();
+
+    TableStats stats = hash_table.Stats();
+    double insert_ns = chrono::duration<double, nano>(inserted - start).count() / words.size();
+    double lookup_ns = chrono::duration<double, nano>(looked_up - inserted).count() /
+                       (words.size() + misses.size());
+    std::cout << policy_name << "\t" << table_name
+              << "\t" << stats.slots
+              << "\t" << stats.elements / (double)stats.slots
+              << "\t" << stats.bytes_used
+              << "\t" << stats.rehash_count
+              << "\t" << insert_ns
+              << "\t" << lookup_ns
+              << "\t" << hit_probes / (double)words.size()
+              << "\t" << max_hit_probes
+              << "\t" << miss_probes / (double)misses.size()
+              << std::endl;
+}
+
+// @words_filename: a filename of input words to construct the hash tables
+// Compares fixed and adaptive growth policies on the linear, quadratic and
+// double tables. Misses are the words with a character appended that no
+// word contains. The quadratic table caps every policy at half full.
+void CompareGrowthPolicies(const string &words_filename, int r_value)
+{
+    fstream wfile(words_filename);
+    vector<string> words, misses;
+    string line;
+    while (wfile >> line)
+    {
+        words.push_back(line);
+        misses.push_back(line + "#");
+    }
+
+    const vector<pair<string, GrowthPolicy>> policies = {
+        {"fixed_0.5", GrowthPolicy(0.5)},
+        {"fixed_0.7", GrowthPolicy(0.7)},
+        {"fixed_0.9", GrowthPolicy(0.9)},
+        {"fixed_0.95", GrowthPolicy(0.95)},
+        {"fixed_0.7_x1.5", GrowthPolicy(0.7, 1.5)},
+        {"adaptive_avg2.5", GrowthPolicy::Adaptive(2.5, 0)},
+        {"adaptive_avg4", GrowthPolicy::Adaptive(4, 0)},
+        {"adaptive_max32", GrowthPolicy::Adaptive(0, 32)},
+        {"adaptive_avg2.5_0.95", GrowthPolicy::Adaptive(2.5, 0, 0.95)},
+        {"adaptive_max32_0.95", GrowthPolicy::Adaptive(0, 32, 0.95)},
+    };
+    std::cout << "policy\ttable\tslots\tload_factor\tbytes_used\trehashes"
+              << "\tinsert_ns\tlookup_ns\thit_probes\tmax_hit_probes\tmiss_probes" << std::endl;
+    for (const auto &policy : policies)
+    {
+        HashTableLinear<string> linear_probing_table;
+        CompareGrowth(policy.first, "linear", linear_probing_table, policy.second, words, misses);
+        HashTable<string> quadratic_probing_table;
+        CompareGrowth(policy.first, "quadratic", quadratic_probing_table, policy.second, words, misses);
+        HashTableDouble<string> double_probing_table(r_value, 101);
+        CompareGrowth(policy.first, "double", double_probing_table, policy.second, words, misses);
+    }
+}
+
+// @table_name: label printed for the table type under test
+// @hash_table: an empty hash table that leaves tombstones
+// @words: words to insert, then remove and re-insert
+// @cycles: remove/re-insert cycles over words
+// Prints one row of the tombstone churn check: the tombstones the table
+// counts against those actually in it. Returns if they agree.
+template <typename HashTableType>
+bool CheckChurn(const string &table_name, HashTableType &hash_table,
+                const vector<string> &words, size_t cycles)
+{
+    for (const string &word : words)
+        hash_table.Insert(word);
+    for (size_t cycle = 0; cycle < cycles; cycle++)
+    {
+        for (const string &word : words)
+        {
+            hash_table.Remove(word);
+            hash_table.Insert(word);
+        }
+    }
+    TableStats stats = hash_table.Stats();
+    bool agree = static_cast<size_t>(hash_table.TotalTombstones()) == stats.tombstones &&
+                 stats.elements == words.size();
+    std::cout << table_name
+              << "\t" << hash_table.TotalTombstones()
+              << "\t" << stats.tombstones
+              << "\t" << stats.elements
+              << "\t" << stats.rehash_count
+              << "\t" << (agree ? "ok" : "FAIL")
+              << std::endl;
+    return agree;
+}
+
+// @words_filename: a filename of input words
+// Removes and re-inserts the first 1000 words 100 times over in the
+// quadratic and double tables, which must reuse each key's own tombstone
+// rather than leave a new one. Ends with a PASS or FAIL line, since main
+// discards the return value; returns non-zero if any count is off.
+int CheckTombstoneChurn(const string &words_filename, int r_value)
+{
+    fstream wfile(words_filename);
+    vector<string> words;
+    string line;
+    while (words.size() < 1000 && wfile >> line)
+        words.push_back(line);
+
+    std::cout << "table\ttotal_tombstones\tstats_tombstones\telements\trehashes\tresult"
+              << std::endl;
+    HashTable<string> quadratic_probing_table;
+    bool agree = CheckChurn("quadratic", quadratic_probing_table, words, 100);
+    HashTableDouble<string> double_probing_table(r_value, 101);
+    agree &= CheckChurn("double", double_probing_table, words, 100);
+    std::cout << (agree ? "PASS" : "FAIL") << ": tombstone churn" << std::endl;
+    return agree ? 0 : 1;
+}
+
+// @words_filename: a filename of input words to construct the hash table
+// @max_threads: the largest thread count to try
+// Builds a HashTableConcurrent from words_filename with 1, 2, 4, ... up to
+// max_threads threads, each inserting an equal share of the words, and
+// prints one row per thread count with the build time and the speedup over
+// a single thread.
+void CompareConcurrentInserts(const string &words_filename, size_t max_threads)
+{
+    fstream wfile(words_filename);
+    vector<string> words;
+    string line;
+    while (wfile >> line)
+        words.push_back(line);
+
+    std::cout << "threads	number_of_elements	size_of_table	insert_ms	speedup"
+              << std::endl;
+    double single_thread_ms = 0;
+    for (size_t thread_count = 1;; thread_count = min(2 * thread_count, max_threads))
     {
-        try
+        HashTableConcurrent<string> concurrent_table;
+        auto start = chrono::steady_clock::now();
+        vector<thread> pool;
+        for (size_t t = 0; t < thread_count; t++)
         {
-            int m = hash_table.Get(line);
-            std::cout << line << " Found " << m << "" << std::endl;
+            pool.emplace_back([&, t]()
+                              {
+                                  size_t begin = words.size() * t / thread_count;
+                                  size_t end = words.size() * (t + 1) / thread_count;
+                                  for (size_t x = begin; x < end; x++)
+                                      concurrent_table.Insert(words[x]);
+                              });
         }
-        catch(const std::exception& e)
+        for (auto &worker : pool)
+            worker.join();
+        double insert_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (thread_count == 1)
+            single_thread_ms = insert_ms;
+
+        std::cout << thread_count
+                  << "\t" << concurrent_table.TotalElements()
+                  << "\t" << concurrent_table.InternalSize()
+                  << "\t" << insert_ms
+                  << "\t" << single_thread_ms / insert_ms
+                  << std::endl;
+        if (thread_count == max_threads)
+            break;
+    }
+}
+
+// @table_name: the table's key in the JSON object
+// @hash_table: an empty hash table
+// @words: words to insert
+// @queries: words to look up after the inserts
+// Fills hash_table and looks up every word and every query with Get, which
+// records hits and misses, then writes "table_name":{...} with its Stats().
+template <typename HashTableType>
+void WriteTableStats(const string &table_name, HashTableType &hash_table,
+                     const vector<string> &words, const vector<string> &queries)
+{
+    for (const string &word : words)
+        hash_table.Insert(word);
+    for (const vector<string> *lookups : {&words, &queries})
+    {
+        for (const string &lookup : *lookups)
         {
-            std::cout << line << ": Not_found " << hash_table.temp_collisions_ << "" << std::endl;
-        }        
+            try
+            {
+                hash_table.Get(lookup);
+            }
+            catch (const exception &)
+            {
+                // A miss; Get has already recorded it.
+            }
+        }
     }
+    std::cout << "\"" << table_name << "\":";
+    hash_table.Stats().WriteJson(std::cout);
+}
+
+// @words_filename: a filename of input words to construct the hash tables
+// @query_filename: a filename of input words to look up afterwards
+// Prints the Stats() of every table variant, built from the same words, as
+// one JSON object keyed by table name.
+void DumpTableStats(const string &words_filename, const string &query_filename,
+                    int r_value)
+{
+    fstream wfile(words_filename);
+    fstream qfile(query_filename);
+    vector<string> words, queries;
+    string line;
+    while (wfile >> line)
+        words.push_back(line);
+    while (qfile >> line)
+        queries.push_back(line);
 
+    std::cout << "{";
+    HashTableLinear<string> linear_probing_table;
+    WriteTableStats("linear", linear_probing_table, words, queries);
+    std::cout << ",";
+    HashTable<string> quadratic_probing_table;
+    WriteTableStats("quadratic", quadratic_probing_table, words, queries);
+    std::cout << ",";
+    HashTableDouble<string> double_probing_table(r_value, 101);
+    WriteTableStats("double", double_probing_table, words, queries);
+    std::cout << ",";
+    HashTableRobinHood<string> robin_hood_table;
+    WriteTableStats("robinhood", robin_hood_table, words, queries);
+    std::cout << ",";
+    HashTableSwiss<string> swiss_table;
+    WriteTableStats("swiss", swiss_table, words, queries);
+    std::cout << ",";
+    HashTableCuckoo<string> cuckoo_table;
+    WriteTableStats("cuckoo", cuckoo_table, words, queries);
+    std::cout << ",";
+    ArenaStringTable<> arena_table(r_value, 101);
+    WriteTableStats("arena", arena_table, words, queries);
+    std::cout << "}" << std::endl;
+}
+
+// @text: a command line argument
+// @value: set to the parsed integer, only on success
+// Parses text, all of it, as a positive integer. Returns false for anything
+// else: no digits, trailing characters, zero, negatives or out of range.
+bool ParsePositive(const char *text, int &value)
+{
+    const char *end = text + strlen(text);
+    int parsed = 0;
+    auto result = from_chars(text, end, parsed);
+    if (result.ec != errc() || result.ptr != end || parsed <= 0)
+        return false;
+    value = parsed;
+    return true;
+}
+
+// @program: argv[0]
+// Prints how to run program, as main does, and what the optional fifth
+// argument means.
+void PrintUsage(const char *program)
+{
+    cout << "Usage: " << program
+         << " <wordsfilename> <queryfilename> <flag>" << endl;
+    cout << "or Usage: " << program
+         << " <wordsfilename> <queryfilename> <flag> <rvalue>" << endl;
+    cout << "or Usage: " << program
+         << " <wordsfilename> <queryfilename> concurrent <max_threads>" << endl;
 }
 
 // @argument_count: argc as provided in main
@@ -71,12 +448,18 @@ int testHashingWrapper(int argument_count, char **argument_list)
     const string words_filename(argument_list[1]);
     const string query_filename(argument_list[2]);
 const string param_flag(argument_list[3]);
-    int R = 89;
-    if (argument_count == 5)
+    // The optional fifth argument is the R value of the double hashing
+    // tables, except for concurrent, which takes the largest thread count.
+    const bool takes_threads = param_flag == "concurrent";
+    int argument_value = 0;
+    if (argument_count == 5 && !ParsePositive(argument_list[4], argument_value))
     {
-        const string rvalue(argument_list[4]);
-        R = stoi(rvalue);
+        cout << "Invalid " << (takes_threads ? "max_threads " : "rvalue ")
+             << argument_list[4] << endl;
+        PrintUsage(argument_list[0]);
+        return 1;
     }
+    const int R = argument_value > 0 && !takes_threads ? argument_value : 89;
     
     if (param_flag == "linear")
     {
@@ -93,16 +476,65 @@ const string param_flag(argument_list[3]);
     }
     else if (param_flag == "double")
     {
-        cout << "r_value: " << R << endl;
+        ReportWriter(cout, ReportOptions::FromEnvironment()).Stat("r_value", R);
         // Uncomment below when you have implemented double hashing.
         HashTableDouble<string> double_probing_table(R, 101);
         TestFunctionForHashTable(double_probing_table, words_filename,
         			 query_filename);
     }
+    else if (param_flag == "robinhood")
+    {
+        HashTableRobinHood<string> robin_hood_table;
+        TestFunctionForHashTable(robin_hood_table, words_filename,
+                                 query_filename);
+    }
+    else if (param_flag == "swiss")
+    {
+        HashTableSwiss<string> swiss_table;
+        TestFunctionForHashTable(swiss_table, words_filename,
+                                 query_filename);
+    }
+    else if (param_flag == "cuckoo")
+    {
+        HashTableCuckoo<string> cuckoo_table;
+        TestFunctionForHashTable(cuckoo_table, words_filename,
+                                 query_filename);
+    }
+    else if (param_flag == "arena")
+    {
+        ReportWriter(cout, ReportOptions::FromEnvironment()).Stat("r_value", R);
+        ArenaStringTable<> arena_table(R, 101);
+        TestFunctionForHashTable(arena_table, words_filename,
+                                 query_filename);
+    }
+    else if (param_flag == "hashers")
+    {
+        CompareHashers(words_filename, query_filename, R);
+    }
+    else if (param_flag == "growth")
+    {
+        CompareGrowthPolicies(words_filename, R);
+    }
+    else if (param_flag == "churn")
+    {
+        return CheckTombstoneChurn(words_filename, R);
+    }
+    else if (param_flag == "stats")
+    {
+        DumpTableStats(words_filename, query_filename, R);
+    }
+    else if (param_flag == "concurrent")
+    {
+        size_t max_threads = max(1u, thread::hardware_concurrency());
+        if (argument_value > 0)
+            max_threads = argument_value;
+        CompareConcurrentInserts(words_filename, max_threads);
+    }
     else
     {
         cout << "Unknown tree type " << param_flag
-             << " (User should provide linear, quadratic, or double)" << endl;
+             << " (User should provide linear, quadratic, double, robinhood, swiss, cuckoo, arena, hashers, growth, churn, stats, or concurrent;"
+             << " the optional fifth argument is the double hashing rvalue, or the largest thread count for concurrent)" << endl;
     }
     return 0;
 }
@@ -0,0 +1,837 @@
+/**
+ * @file cuckoo_hashing.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for
+ *        HashTableCuckoo (bucketized cuckoo hashing with a stash)
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Every element lives in one of two buckets of 4 slots, picked by two hash
+ * functions, or in a small stash. A lookup therefore examines at most two
+ * buckets (plus the stash, which is almost always empty), however full the
+ * table is; linear, quadratic and double probing give no such bound.
+ *
+ * Each bucket keeps a 64-bit word of four 16-bit tags, one per slot, in an
+ * array apart from the keys. A lookup reads the tag words of its two buckets,
+ * at most two cache lines, and only compares the keys whose tag matches; a
+ * hit, or a false tag match, touches one more line for that key's slot.
+ *
+ * An insert that finds both buckets full evicts an element of one of them to
+ * that element's other bucket, and so on, for up to kMaxKicks evictions; the
+ * element still homeless then goes to the stash. The table grows once the
+ * stash holds more than kStashSize elements or nine tenths of the slots are
+ * full. Keys whose hashes collide in full overflow the stash at any size, so
+ * a rehash doubles at most kMaxRehashDoublings times more; past that it keeps
+ * the size it was asked for and lets the stash grow instead.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef CUCKOO_HASHING_H
+#define CUCKOO_HASHING_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#include "lookup_key.h"
+#include "prefetch.h"
+#include "table_stats.h"
+
+template <typename HashedObj, typename Hasher = std::hash<HashedObj>>
+class HashTableCuckoo
+{
+public:
+  static const size_t kBucketWidth = 4;
+
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
+  /**
+   * @brief Construct a new Hash Table Cuckoo object
+   *
+   * @param size
+   */
+  explicit HashTableCuckoo(size_t size = 101)
+  {
+    Allocate(BucketCount(size));
+  }
+
+  /**
+   * @brief Construct a new Hash Table Cuckoo object sized once for the range
+   *        [first, last) and filled from it
+   *
+   * @param first
+   * @param last
+   */
+  template <typename ForwardIt,
+            typename = typename std::enable_if<!std::is_integral<ForwardIt>::value>::type>
+  HashTableCuckoo(ForwardIt first, ForwardIt last)
+  {
+    Allocate(BucketCount(MinimumSlots(std::distance(first, last))));
+    for (; first != last; ++first)
+      Insert(*first);
+  }
+
+  /**
+   * @brief returns if x is in this HashTable object
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  template <typename Key>
+  bool Contains(const Key &x) const
+  {
+    return Find(x).found;
+  }
+
+  /**
+   * @brief deletes all entries in this HashTable
+   *
+   */
+  void MakeEmpty()
+  {
+    current_size_ = 0;
+    std::fill(tags_.begin(), tags_.end(), 0);
+    stash_.clear();
+    stash_limit_ = kStashSize;
+  }
+
+  /**
+   * @brief size the table once so that n elements fit without any further
+   *        rehashing
+   *
+   * @param n
+   */
+  void Reserve(size_t n)
+  {
+    size_t buckets = BucketCount(MinimumSlots(n));
+    if (buckets > bucket_mask_ + 1)
+      Rehash(buckets);
+  }
+
+  /**
+   * @brief grow the table to at least slots slots (rounded up the way the
+   *        table sizes itself) and rehash every element into it. Reserve
+   *        takes an element count instead.
+   *
+   * @param slots
+   */
+  void ReserveSlots(size_t slots)
+  {
+    size_t buckets = BucketCount(slots);
+    if (buckets > bucket_mask_ + 1)
+      Rehash(buckets);
+  }
+
+  /**
+   * @brief return how many buckets it took to find in, otherwise throw an
+   *        exception
+   *
+   * @param in
+   * @return int
+   */
+  int Get(const HashedObj &in)
+  {
+    if (FindPos(in) == kNotFound)
+    {
+      stats_.miss_probes.Add(temp_collisions_);
+      throw KeyError();
+    }
+    stats_.hit_probes.Add(temp_collisions_);
+    return temp_collisions_;
+  }
+
+  /**
+   * @brief look up in without throwing; reports the buckets examined whether
+   *        or not it was found, which is 1 or 2, or 3 when the stash had to
+   *        be searched too. Find writes nothing, so any number of threads may
+   *        call it at once while no thread modifies the table; its probes are
+   *        not added to TotalCollisions. in may be any key type that
+   *        lookup_key.h can hash, e.g. a std::string_view into a string table.
+   *
+   * @param in
+   * @return LookupResult
+   */
+  template <typename Key>
+  LookupResult Find(const Key &in) const
+  {
+    int probes;
+    bool found = FindPos(in, probes) != kNotFound;
+    return LookupResult{found, probes};
+  }
+
+  /**
+   * @brief Find every key in [first, last), writing one LookupResult per key
+   *        to results. Each batch of keys is hashed and has the tag words of
+   *        both its buckets prefetched before any of them is probed, so their
+   *        cache misses overlap instead of being paid one at a time.
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    size_t hashes[kPrefetchBatch];
+    while (first != last)
+    {
+      ForwardIt batch = first;
+      size_t count = 0;
+      for (; first != last && count < kPrefetchBatch; ++first, ++count)
+      {
+        const auto &key = *first;
+        hashes[count] = Hash(key);
+        size_t bucket = PrimaryBucket(hashes[count]);
+        Prefetch(&tags_[bucket]);
+        Prefetch(&tags_[AlternateBucket(hashes[count], bucket)]);
+        Prefetch(&slots_[bucket * kBucketWidth]);
+      }
+      for (size_t x = 0; x < count; ++x, ++batch)
+      {
+        int probes;
+        bool found = FindPos(*batch, hashes[x], probes) != kNotFound;
+        *results++ = LookupResult{found, probes};
+      }
+    }
+    return results;
+  }
+
+  /**
+   * @brief insert new element into HashTable
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Insert(const HashedObj &x)
+  {
+    return InsertNew(x);
+  }
+
+  /**
+   * @brief insert new element into HashTable, moving it in
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Insert(HashedObj &&x)
+  {
+    return InsertNew(std::move(x));
+  }
+
+  /**
+   * @brief find and remove element x
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Remove(const HashedObj &x)
+  {
+    size_t current_pos = FindPos(x);
+    if (current_pos == kNotFound)
+      return false;
+
+    if (current_pos >= slots_.size())
+    {
+      stash_.erase(stash_.begin() + (current_pos - slots_.size()));
+    }
+    else
+    {
+      SetTag(current_pos, 0);
+      // The freed slot may give a stashed element a place in its buckets.
+      DrainStash();
+    }
+    current_size_--;
+    return true;
+  }
+
+  /**
+   * @brief return total collisions: the evictions inserts made, the elements
+   *        they stashed, and the lookups that had to search the stash.
+   *        Checking the second bucket is every miss's fixed cost and does
+   *        not count.
+   *
+   * @return int
+   */
+  int TotalCollisions()
+  {
+    return collisions_;
+  }
+
+  /**
+   * @brief returns total elements in HashTable
+   *
+   * @return int
+   */
+  int TotalElements()
+  {
+    return this->total_elements_;
+  }
+
+  /**
+   * @brief returns internal HashTable allocated size
+   *
+   * @return int
+   */
+  int InternalSize()
+  {
+    return this->slots_.size();
+  }
+
+  /**
+   * @brief returns the table's health statistics; see table_stats.h. Probe
+   *        lengths here count buckets, not slots; the evictions each insert
+   *        made are in displacements.
+   *
+   * @return TableStats
+   */
+  TableStats Stats() const
+  {
+    TableStats stats = stats_;
+    stats.elements = current_size_;
+    stats.slots = slots_.size();
+    stats.tombstones = 0;
+    stats.bytes_used = tags_.capacity() * sizeof(uint64_t) +
+                       (slots_.capacity() + stash_.capacity()) * sizeof(HashedObj);
+    stats.cluster_sizes = ClusterSizes(slots_.size(), [this](size_t pos)
+                                       { return LaneTag(pos) != 0; });
+    return stats;
+  }
+  int temp_collisions_ = 0;
+
+private:
+  // Position FindPos returns for an absent element. Positions past the slots
+  // are stash entries: slots_.size() + i is stash_[i].
+  static const size_t kNotFound = SIZE_MAX;
+  // Evictions an insert makes before it stashes the element left over.
+  static const int kMaxKicks = 500;
+  // Stashed elements the table tolerates before it grows.
+  static const size_t kStashSize = 4;
+  // Extra doublings a rehash tries before it accepts a larger stash.
+  static const int kMaxRehashDoublings = 2;
+  // Every 16-bit lane of a tag word set to 1, and to its top bit.
+  static const uint64_t kLaneOnes = 0x0001000100010001;
+  static const uint64_t kLaneHighs = 0x8000800080008000;
+
+  /**
+   * @brief error object if a key is not found
+   *
+   */
+  struct KeyError : public std::exception
+  {
+    const char *what() const throw()
+    {
+      return "Key Not Found";
+    }
+  };
+
+  // Four 16-bit tags per bucket, lane i for slot i. A full slot's tag has
+  // its top bit set; an empty slot's tag is 0.
+  std::vector<uint64_t> tags_;
+  std::vector<HashedObj> slots_;
+  std::vector<HashedObj> stash_;
+  // Stashed elements that trigger a rehash: kStashSize, or twice the stash
+  // a rehash could not empty.
+  size_t stash_limit_ = kStashSize;
+  size_t bucket_mask_;
+  // Elements in the slots and the stash.
+  size_t current_size_;
+  size_t total_elements_ = 0;
+  size_t collisions_ = 0;
+  // State of the xorshift generator that picks which element to evict.
+  uint64_t kick_state_ = 0x9e3779b97f4a7c15;
+  // Recorded parts of Stats().
+  TableStats stats_;
+
+  /**
+   * @brief returns the tag an element with this hash has
+   *
+   * @param hash
+   * @return uint16_t
+   */
+  static uint16_t Tag(size_t hash)
+  {
+    return static_cast<uint16_t>(static_cast<uint64_t>(hash) >> 48) | 0x8000;
+  }
+
+  /**
+   * @brief returns the first of the two buckets an element with this hash
+   *        may be in
+   *
+   * @param hash
+   * @return size_t
+   */
+  size_t PrimaryBucket(size_t hash) const
+  {
+    return hash & bucket_mask_;
+  }
+
+  /**
+   * @brief returns the second bucket, never the same as primary. It is taken
+   *        from a remix of the hash, so elements sharing a primary bucket
+   *        scatter to different second ones.
+   *
+   * @param hash
+   * @param primary PrimaryBucket(hash)
+   * @return size_t
+   */
+  size_t AlternateBucket(size_t hash, size_t primary) const
+  {
+    uint64_t mixed = (static_cast<uint64_t>(hash) ^ (static_cast<uint64_t>(hash) >> 31)) *
+                     UINT64_C(0x9e3779b97f4a7c15);
+    size_t bucket = (mixed >> 32) & bucket_mask_;
+    return bucket != primary ? bucket : bucket ^ 1;
+  }
+
+  /**
+   * @brief returns the bucket an element with this hash may be in other
+   *        than bucket
+   *
+   * @param hash
+   * @param bucket
+   * @return size_t
+   */
+  size_t OtherBucket(size_t hash, size_t bucket) const
+  {
+    size_t primary = PrimaryBucket(hash);
+    return bucket != primary ? primary : AlternateBucket(hash, primary);
+  }
+
+  /**
+   * @brief returns the tag of slot pos
+   *
+   * @param pos
+   * @return uint16_t
+   */
+  uint16_t LaneTag(size_t pos) const
+  {
+    return static_cast<uint16_t>(tags_[pos / kBucketWidth] >> (16 * (pos % kBucketWidth)));
+  }
+
+  /**
+   * @brief sets the tag of slot pos
+   *
+   * @param pos
+   * @param tag
+   */
+  void SetTag(size_t pos, uint16_t tag)
+  {
+    unsigned shift = 16 * (pos % kBucketWidth);
+    uint64_t &word = tags_[pos / kBucketWidth];
+    word = (word & ~(UINT64_C(0xffff) << shift)) | (static_cast<uint64_t>(tag) << shift);
+  }
+
+  /**
+   * @brief returns a mask with the top bit of every lane of bucket whose tag
+   *        equals tag set. As full tags and tag have their top bit set, the
+   *        XOR clears it in the lanes that may match, and the lanes are
+   *        tested for zero without a borrow crossing between them.
+   *
+   * @param bucket
+   * @param tag
+   * @return uint64_t
+   */
+  uint64_t MatchTag(size_t bucket, uint16_t tag) const
+  {
+    uint64_t x = tags_[bucket] ^ (kLaneOnes * tag);
+    uint64_t y = (x | kLaneHighs) - kLaneOnes;
+    return ~x & ~y & kLaneHighs;
+  }
+
+  /**
+   * @brief returns a mask with the top bit of every empty lane of bucket set
+   *
+   * @param bucket
+   * @return uint64_t
+   */
+  uint64_t MatchFree(size_t bucket) const
+  {
+    return ~tags_[bucket] & kLaneHighs;
+  }
+
+  /**
+   * @brief returns the slot of bucket that the lowest lane set in mask stands
+   *        for
+   *
+   * @param bucket
+   * @param mask
+   * @return size_t
+   */
+  static size_t LaneSlot(size_t bucket, uint64_t mask)
+  {
+#if defined(__GNUC__)
+    size_t bit = __builtin_ctzll(mask);
+#else
+    size_t bit = 0;
+    for (; (mask & 1) == 0; mask >>= 1)
+      bit++;
+#endif
+    return bucket * kBucketWidth + bit / 16;
+  }
+
+  /**
+   * @brief returns the slot of bucket holding x, or kNotFound
+   *
+   * @param x
+   * @param bucket
+   * @param tag
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindInBucket(const Key &x, size_t bucket, uint16_t tag) const
+  {
+    for (uint64_t mask = MatchTag(bucket, tag); mask != 0; mask &= mask - 1)
+    {
+      size_t current_pos = LaneSlot(bucket, mask);
+      if (slots_[current_pos] == x)
+        return current_pos;
+    }
+    return kNotFound;
+  }
+
+  /**
+   * @brief returns the position of the object x in the HashMap, or kNotFound
+   *        if it is absent
+   *
+   * @param x
+   * @return size_t
+   */
+  size_t FindPos(const HashedObj &x)
+  {
+    int probes;
+    size_t current_pos = FindPos(x, probes);
+    temp_collisions_ = probes;
+    if (probes > 2)
+      collisions_++;
+    return current_pos;
+  }
+
+  /**
+   * @brief the lookup behind FindPos. It only reads the table and reports
+   *        the buckets it examined through probes.
+   *
+   * @param x
+   * @param probes set to the number of buckets examined
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, int &probes) const
+  {
+    return FindPos(x, Hash(x), probes);
+  }
+
+  /**
+   * @brief the lookup for a caller that already has hash == Hash(x)
+   *
+   * @param x
+   * @param hash
+   * @param probes set to the number of buckets examined, counting the stash
+   *        as one
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, size_t hash, int &probes) const
+  {
+    uint16_t tag = Tag(hash);
+    size_t bucket = PrimaryBucket(hash);
+    probes = 1;
+    size_t current_pos = FindInBucket(x, bucket, tag);
+    if (current_pos != kNotFound)
+      return current_pos;
+
+    probes = 2;
+    current_pos = FindInBucket(x, AlternateBucket(hash, bucket), tag);
+    if (current_pos != kNotFound || stash_.empty())
+      return current_pos;
+
+    probes = 3;
+    for (size_t i = 0; i < stash_.size(); i++)
+    {
+      if (stash_[i] == x)
+        return slots_.size() + i;
+    }
+    return kNotFound;
+  }
+
+  /**
+   * @brief adds x, known to be absent, and grows the table if it has become
+   *        too full
+   *
+   * @param x
+   * @return true
+   * @return false if x was already present
+   */
+  template <typename Obj>
+  bool InsertNew(Obj &&x)
+  {
+    this->total_elements_++;
+    size_t hash = Hash(x);
+    int probes;
+    size_t current_pos = FindPos(x, hash, probes);
+    temp_collisions_ = probes;
+    stats_.insert_probes.Add(probes);
+    if (current_pos != kNotFound)
+    {
+      if (probes > 2)
+        collisions_++;
+      return false;
+    }
+
+    size_t stashed = stash_.size();
+    int kicks = Place(std::forward<Obj>(x), hash);
+    stats_.displacements.Add(kicks);
+    collisions_ += kicks + (stash_.size() - stashed);
+    ++current_size_;
+
+    if (stash_.size() > stash_limit_ || current_size_ > slots_.size() - slots_.size() / 10)
+    {
+      Rehash();
+    }
+    return true;
+  }
+
+  /**
+   * @brief stores x, known to be absent, in a free slot of one of its
+   *        buckets, evicting elements to their other buckets to make room if
+   *        need be, and stashing whichever element is left without a slot
+   *        after kMaxKicks evictions
+   *
+   * @param x
+   * @param hash
+   * @return int the number of evictions made
+   */
+  template <typename Obj>
+  int Place(Obj &&x, size_t hash)
+  {
+    size_t bucket = PrimaryBucket(hash);
+    size_t alternate = AlternateBucket(hash, bucket);
+    uint64_t mask = MatchFree(bucket);
+    if (mask == 0 && (mask = MatchFree(alternate)) != 0)
+      bucket = alternate;
+    if (mask != 0)
+    {
+      size_t current_pos = LaneSlot(bucket, mask);
+      SetTag(current_pos, Tag(hash));
+      slots_[current_pos] = std::forward<Obj>(x);
+      return 0;
+    }
+
+    // Both buckets are full: x takes a random slot of one of them and the
+    // element it evicts moves on to its own other bucket.
+    HashedObj homeless = std::forward<Obj>(x);
+    uint16_t tag = Tag(hash);
+    bucket = (NextRandom() & 1) ? bucket : alternate;
+    for (int kicks = 1; kicks <= kMaxKicks; kicks++)
+    {
+      size_t current_pos = bucket * kBucketWidth + NextRandom() % kBucketWidth;
+      std::swap(homeless, slots_[current_pos]);
+      SetTag(current_pos, tag);
+
+      hash = Hash(homeless);
+      tag = Tag(hash);
+      bucket = OtherBucket(hash, bucket);
+      if ((mask = MatchFree(bucket)) != 0)
+      {
+        current_pos = LaneSlot(bucket, mask);
+        SetTag(current_pos, tag);
+        slots_[current_pos] = std::move(homeless);
+        return kicks;
+      }
+    }
+    stash_.push_back(std::move(homeless));
+    return kMaxKicks;
+  }
+
+  /**
+   * @brief moves every stashed element that has a free slot in one of its
+   *        buckets there
+   *
+   */
+  void DrainStash()
+  {
+    for (size_t i = 0; i < stash_.size();)
+    {
+      size_t hash = Hash(stash_[i]);
+      size_t bucket = PrimaryBucket(hash);
+      uint64_t mask = MatchFree(bucket);
+      if (mask == 0)
+        mask = MatchFree(bucket = AlternateBucket(hash, bucket));
+      if (mask == 0)
+      {
+        i++;
+        continue;
+      }
+      size_t current_pos = LaneSlot(bucket, mask);
+      SetTag(current_pos, Tag(hash));
+      slots_[current_pos] = std::move(stash_[i]);
+      stash_.erase(stash_.begin() + i);
+    }
+  }
+
+  /**
+   * @brief returns the next number of an xorshift sequence
+   *
+   * @return uint64_t
+   */
+  uint64_t NextRandom()
+  {
+    kick_state_ ^= kick_state_ << 13;
+    kick_state_ ^= kick_state_ >> 7;
+    kick_state_ ^= kick_state_ << 17;
+    return kick_state_;
+  }
+
+  /**
+   * @brief when the table reaches load capacity, double the bucket count and
+   *        reinsert all elements
+   *
+   */
+  void Rehash()
+  {
+    Rehash(2 * (bucket_mask_ + 1));
+  }
+
+  /**
+   * @brief resize the table to buckets buckets and reinsert all elements,
+   *        doubling again, up to kMaxRehashDoublings times, if they overflow
+   *        the stash. If they still do, the table keeps buckets buckets and
+   *        the oversized stash.
+   *
+   * @param buckets a power of two
+   */
+  void Rehash(size_t buckets)
+  {
+    RehashTimer timer(stats_);
+    std::vector<HashedObj> elements = TakeElements();
+    for (int doublings = 0; doublings <= kMaxRehashDoublings; doublings++)
+    {
+      Refill(buckets << doublings, elements);
+      if (stash_.size() <= kStashSize)
+      {
+        stash_limit_ = kStashSize;
+        return;
+      }
+      elements = TakeElements();
+    }
+    Refill(buckets, elements);
+    // Doubling the limit keeps the rehashes logarithmic in the keys that
+    // share their buckets.
+    stash_limit_ = 2 * stash_.size();
+  }
+
+  /**
+   * @brief empties the table, sizes it to buckets buckets and places
+   *        elements in it
+   *
+   * @param buckets a power of two, at least 2
+   * @param elements moved from
+   */
+  void Refill(size_t buckets, std::vector<HashedObj> &elements)
+  {
+    Allocate(buckets);
+    for (HashedObj &element : elements)
+    {
+      Place(std::move(element), Hash(element));
+      ++current_size_;
+    }
+  }
+
+  /**
+   * @brief moves every element out of the slots and the stash
+   *
+   * @return std::vector<HashedObj>
+   */
+  std::vector<HashedObj> TakeElements()
+  {
+    std::vector<HashedObj> elements;
+    elements.reserve(current_size_);
+    for (size_t pos = 0; pos < slots_.size(); pos++)
+    {
+      if (LaneTag(pos) != 0)
+        elements.push_back(std::move(slots_[pos]));
+    }
+    for (HashedObj &element : stash_)
+      elements.push_back(std::move(element));
+    return elements;
+  }
+
+  /**
+   * @brief sizes the table to hold buckets buckets, all empty
+   *
+   * @param buckets a power of two, at least 2
+   */
+  void Allocate(size_t buckets)
+  {
+    tags_.assign(buckets, 0);
+    slots_.assign(buckets * kBucketWidth, HashedObj{});
+    stash_.clear();
+    bucket_mask_ = buckets - 1;
+    current_size_ = 0;
+  }
+
+  /**
+   * @brief returns the smallest power-of-two bucket count, at least 2 so
+   *        that every element has two distinct buckets, covering size slots
+   *
+   * @param size
+   * @return size_t
+   */
+  static size_t BucketCount(size_t size)
+  {
+    size_t buckets = 2;
+    while (buckets * kBucketWidth < size)
+      buckets *= 2;
+    return buckets;
+  }
+
+  /**
+   * @brief returns the fewest slots that hold n elements below the 9/10 load cap
+   *
+   * @param n
+   * @return size_t
+   */
+  static size_t MinimumSlots(size_t n)
+  {
+    return n + n / 9 + 1;
+  }
+
+  /**
+   * @brief returns the full hash of x, which is a HashedObj or a lookup
+   *        key equal to one
+   *
+   * @param x
+   * @return size_t
+   */
+  template <typename Key>
+  static size_t Hash(const Key &x)
+  {
+    static Hasher hf;
+    return HashLookupKey(hf, x);
+  }
+};
+
+#endif // CUCKOO_HASHING_H
@@ -0,0 +1,171 @@
+/**
+ * @file document_tokenizer.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for
+ *        DocumentTokenizer, which streams the words of a document file
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * The document is read in fixed-size blocks. Each block is scanned once:
+ * separators are skipped and the letters of each word are lowercased in
+ * place, so a word is handed out as a std::string_view into the block with
+ * no copy. A word cut off by the end of a block is moved to the front before
+ * the next block is read, so memory stays at one block however large the
+ * document is (the block only grows to hold a single word longer than it).
+ *
+ * Words are separated by whitespace and by punctuation, except apostrophes
+ * and hyphens, which stay inside words ("patel's", "music-swapping").
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef DOCUMENT_TOKENIZER_H
+#define DOCUMENT_TOKENIZER_H
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <locale>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class DocumentTokenizer
+{
+public:
+  static const size_t kDefaultBlockSize = 64 * 1024;
+
+  /**
+   * @brief Construct a new Document Tokenizer object reading filename
+   *
+   * @param filename
+   * @param block_size bytes read from the file at a time
+   */
+  explicit DocumentTokenizer(const std::string &filename,
+                             size_t block_size = kDefaultBlockSize)
+      : in_{filename, std::ios::binary}, buffer_(std::max<size_t>(block_size, 1))
+  {
+  }
+
+  DocumentTokenizer(const DocumentTokenizer &) = delete;
+  DocumentTokenizer &operator=(const DocumentTokenizer &) = delete;
+
+  /**
+   * @brief returns if the document could be opened
+   *
+   * @return true
+   * @return false
+   */
+  bool IsOpen() const
+  {
+    return in_.is_open();
+  }
+
+  /**
+   * @brief sets word to the next word of the document, lowercased. word
+   *        views the tokenizer's buffer and is only valid until the next
+   *        call.
+   *
+   * @param word
+   * @return true
+   * @return false once the document has no words left
+   */
+  bool Next(std::string_view &word)
+  {
+    const CharacterClasses &classes = Classes();
+    // The word being read is [begin_, end).
+    size_t end = begin_;
+    for (;;)
+    {
+      if (end == begin_)
+      {
+        while (begin_ < filled_ && classes.separator[Byte(buffer_[begin_])])
+          begin_++;
+        end = begin_;
+      }
+      while (end < filled_ && !classes.separator[Byte(buffer_[end])])
+      {
+        buffer_[end] = classes.lower[Byte(buffer_[end])];
+        end++;
+      }
+      // Stopped on a separator, or at the end of the document: the word is
+      // complete. Otherwise it may continue in the next block.
+      if (end < filled_ || !Refill(end))
+        break;
+    }
+
+    if (end == begin_)
+      return false;
+    word = std::string_view(buffer_.data() + begin_, end - begin_);
+    begin_ = end;
+    return true;
+  }
+
+private:
+  /**
+   * @brief per-byte lookup tables, so the scan does no locale calls
+   *
+   */
+  struct CharacterClasses
+  {
+    bool separator[256];
+    char lower[256];
+  };
+
+  std::ifstream in_;
+  std::vector<char> buffer_;
+  // Bytes [begin_, filled_) of buffer_ are read but not yet handed out.
+  size_t begin_ = 0;
+  size_t filled_ = 0;
+
+  static unsigned char Byte(char c)
+  {
+    return static_cast<unsigned char>(c);
+  }
+
+  static const CharacterClasses &Classes()
+  {
+    static const CharacterClasses classes = []()
+    {
+      CharacterClasses table;
+      const std::locale loc;
+      for (int i = 0; i < 256; i++)
+      {
+        char c = static_cast<char>(i);
+        table.separator[i] = std::isspace(c, loc) ||
+                             (std::ispunct(c, loc) && c != '\'' && c != '-');
+        table.lower[i] = std::tolower(c, loc);
+      }
+      return table;
+    }();
+    return classes;
+  }
+
+  /**
+   * @brief moves the unread bytes to the front of the buffer, growing it if
+   *        they fill it, and reads the next block after them. end is moved
+   *        along with the bytes.
+   *
+   * @param end
+   * @return true
+   * @return false if nothing more could be read
+   */
+  bool Refill(size_t &end)
+  {
+    if (!in_)
+      return false;
+    std::memmove(buffer_.data(), buffer_.data() + begin_, filled_ - begin_);
+    filled_ -= begin_;
+    end -= begin_;
+    begin_ = 0;
+    if (filled_ == buffer_.size())
+      buffer_.resize(2 * buffer_.size());
+
+    in_.read(buffer_.data() + filled_, buffer_.size() - filled_);
+    filled_ += in_.gcount();
+    return in_.gcount() > 0;
+  }
+};
+
+#endif // DOCUMENT_TOKENIZER_H
@@ -0,0 +1,196 @@
+/**
+ * @file edit_distance.h
+ * @author Moududur Rahman
+ * @brief Edit distance helpers shared by the spell checker's suggestion
+ *        engines
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * EditDistance is the optimal string alignment distance: insertions,
+ * deletions, substitutions and swaps of two adjacent letters each cost 1,
+ * which matches the three kinds of misspelling the spell checker reports
+ * (case A: a letter was left out, case B: a letter was added, case C: two
+ * letters were swapped). It is not a metric, though: it can break the
+ * triangle inequality ("ca" -> "ac" -> "abc" costs 2, but "ca" -> "abc" is
+ * 3), so structures that prune by distance use DamerauDistance, which never
+ * exceeds it and is a metric.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef EDIT_DISTANCE_H
+#define EDIT_DISTANCE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief one correction offered for a misspelled word
+ *
+ */
+struct Suggestion
+{
+  std::string_view word;
+  int distance;
+  // 'A', 'B' or 'C' when word is one of the spell checker's three cases of
+  // misspelling away, otherwise 0.
+  char type;
+};
+
+/**
+ * @brief returns the edit distance between a and b, or max_distance + 1 as
+ *        soon as it is known to be larger than max_distance
+ *
+ * @param a
+ * @param b
+ * @param max_distance
+ * @return int
+ */
+inline int EditDistance(std::string_view a, std::string_view b, int max_distance)
+{
+  int length_gap = static_cast<int>(a.size()) - static_cast<int>(b.size());
+  if (std::abs(length_gap) > max_distance)
+    return max_distance + 1;
+
+  // Three rows of the dynamic programming table: i - 2, i - 1 and i. They
+  // are kept between calls, since searches compute thousands of distances.
+  static thread_local std::vector<int> before, previous, current;
+  before.resize(b.size() + 1);
+  previous.resize(b.size() + 1);
+  current.resize(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); j++)
+    previous[j] = j;
+  for (size_t i = 1; i <= a.size(); i++)
+  {
+    current[0] = i;
+    int row_minimum = current[0];
+    for (size_t j = 1; j <= b.size(); j++)
+    {
+      int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+      current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+      if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+        current[j] = std::min(current[j], before[j - 2] + 1);
+      row_minimum = std::min(row_minimum, current[j]);
+    }
+    if (row_minimum > max_distance)
+      return max_distance + 1;
+    std::swap(before, previous);
+    std::swap(previous, current);
+  }
+  return std::min(previous[b.size()], max_distance + 1);
+}
+
+/**
+ * @brief returns the unrestricted Damerau-Levenshtein distance between a and
+ *        b (swapped letters may also be edited in between), or
+ *        max_distance + 1 if their lengths alone put it above max_distance
+ *
+ * @param a
+ * @param b
+ * @param max_distance
+ * @return int
+ */
+inline int DamerauDistance(std::string_view a, std::string_view b, int max_distance)
+{
+  int length_gap = static_cast<int>(a.size()) - static_cast<int>(b.size());
+  if (std::abs(length_gap) > max_distance)
+    return max_distance + 1;
+
+  // Lowrance-Wagner: table(i + 1, j + 1) is the distance between the first
+  // i letters of a and the first j of b, framed by a row and column of
+  // "infinity" so that transpositions never reach outside the words.
+  const int infinity = a.size() + b.size();
+  const size_t width = b.size() + 2;
+  static thread_local std::vector<int> table;
+  table.resize((a.size() + 2) * width);
+  auto at = [&](size_t i, size_t j) -> int & { return table[i * width + j]; };
+  for (size_t i = 0; i <= a.size(); i++)
+  {
+    at(i + 1, 0) = infinity;
+    at(i + 1, 1) = i;
+  }
+  for (size_t j = 0; j <= b.size(); j++)
+  {
+    at(0, j + 1) = infinity;
+    at(1, j + 1) = j;
+  }
+  at(0, 0) = infinity;
+
+  // Last row of a in which each letter was seen.
+  size_t last_row[256] = {0};
+  for (size_t i = 1; i <= a.size(); i++)
+  {
+    size_t last_column = 0;
+    for (size_t j = 1; j <= b.size(); j++)
+    {
+      size_t k = last_row[static_cast<unsigned char>(b[j - 1])];
+      size_t l = last_column;
+      int cost = 1;
+      if (a[i - 1] == b[j - 1])
+      {
+        cost = 0;
+        last_column = j;
+      }
+      at(i + 1, j + 1) = std::min({at(i, j) + cost, at(i + 1, j) + 1, at(i, j + 1) + 1,
+                                   at(k, l) + static_cast<int>((i - k - 1) + 1 + (j - l - 1))});
+    }
+    last_row[static_cast<unsigned char>(a[i - 1])] = i;
+  }
+  return std::min(at(a.size() + 1, b.size() + 1), max_distance + 1);
+}
+
+/**
+ * @brief returns which of the spell checker's cases turns typo into word:
+ *        'A' if word is typo with one letter inserted, 'B' if word is typo
+ *        with one letter removed, 'C' if word is typo with two adjacent
+ *        letters swapped, otherwise 0
+ *
+ * @param typo
+ * @param word
+ * @return char
+ */
+inline char EditCase(std::string_view typo, std::string_view word)
+{
+  std::string_view longer = typo.size() > word.size() ? typo : word;
+  std::string_view shorter = typo.size() > word.size() ? word : typo;
+  size_t prefix = 0;
+  while (prefix < shorter.size() && shorter[prefix] == longer[prefix])
+    prefix++;
+
+  if (longer.size() == shorter.size() + 1)
+  {
+    // Everything after the first mismatch must line up one letter over.
+    if (shorter.substr(prefix) != longer.substr(prefix + 1))
+      return 0;
+    return word.size() > typo.size() ? 'A' : 'B';
+  }
+  if (longer.size() == shorter.size() && prefix + 1 < word.size() &&
+      typo[prefix] == word[prefix + 1] && typo[prefix + 1] == word[prefix] &&
+      typo.substr(prefix + 2) == word.substr(prefix + 2))
+    return 'C';
+  return 0;
+}
+
+/**
+ * @brief orders suggestions closest first; among equals, the spell checker's
+ *        cases A, B and C come before other edits
+ *
+ * @param suggestions
+ */
+inline void SortSuggestions(std::vector<Suggestion> &suggestions)
+{
+  std::stable_sort(suggestions.begin(), suggestions.end(),
+                   [](const Suggestion &left, const Suggestion &right)
+                   {
+                     if (left.distance != right.distance)
+                       return left.distance < right.distance;
+                     // Cases before untyped edits, then A, B, C.
+                     return (left.type == 0 ? 'Z' : left.type) <
+                            (right.type == 0 ? 'Z' : right.type);
+                   });
+}
+
+#endif // EDIT_DISTANCE_H
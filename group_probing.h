@@ -0,0 +1,599 @@
+/**
+ * @file group_probing.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for HashTableSwiss
+ *        (SIMD group probing over a separate control-byte array)
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Slots are split into groups of 16. A one-byte control array, kept apart
+ * from the keys, records for every slot whether it is empty, deleted, or full
+ * along with 7 bits of the element's hash. A probe compares a whole group of
+ * control bytes at once (one SSE2 compare when available) and only touches a
+ * key when its hash fragment matches.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GROUP_PROBING_H
+#define GROUP_PROBING_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "lookup_key.h"
+#include "prefetch.h"
+#include "table_stats.h"
+
+template <typename HashedObj, typename Hasher = std::hash<HashedObj>>
+class HashTableSwiss
+{
+public:
+  static const size_t kGroupWidth = 16;
+
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
+  /**
+   * @brief Construct a new Hash Table Swiss object
+   *
+   * @param size
+   */
+  explicit HashTableSwiss(size_t size = 101)
+  {
+    Allocate(GroupCount(size));
+  }
+
+  /**
+   * @brief Construct a new Hash Table Swiss object sized once for the range
+   *        [first, last) and filled from it
+   *
+   * @param first
+   * @param last
+   */
+  template <typename ForwardIt,
+            typename = typename std::enable_if<!std::is_integral<ForwardIt>::value>::type>
+  HashTableSwiss(ForwardIt first, ForwardIt last)
+  {
+    Allocate(GroupCount(MinimumSlots(std::distance(first, last))));
+    for (; first != last; ++first)
+      Insert(*first);
+  }
+
+  /**
+   * @brief returns if x is in this HashTable object
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  template <typename Key>
+  bool Contains(const Key &x) const
+  {
+    return Find(x).found;
+  }
+
+  /**
+   * @brief deletes all entries in this HashTable
+   *
+   */
+  void MakeEmpty()
+  {
+    current_size_ = 0;
+    deleted_size_ = 0;
+    std::fill(control_.begin(), control_.end(), kEmpty);
+  }
+
+  /**
+   * @brief size the table once so that n elements fit without any further
+   *        rehashing
+   *
+   * @param n
+   */
+  void Reserve(size_t n)
+  {
+    size_t groups = GroupCount(MinimumSlots(n));
+    if (groups > group_mask_ + 1)
+      Rehash(groups);
+  }
+
+  /**
+   * @brief grow the table to at least slots slots (rounded up the way the
+   *        table sizes itself) and rehash every element into it. Reserve
+   *        takes an element count instead.
+   *
+   * @param slots
+   */
+  void ReserveSlots(size_t slots)
+  {
+    size_t groups = GroupCount(slots);
+    if (groups > group_mask_ + 1)
+      Rehash(groups);
+  }
+
+  /**
+   * @brief return how many groups it took to find in, otherwise throw an exception
+   *
+   * @param in
+   * @return int
+   */
+  int Get(const HashedObj &in)
+  {
+    if (FindPos(in) == slots_.size())
+    {
+      stats_.miss_probes.Add(temp_collisions_);
+      throw KeyError();
+    }
+    stats_.hit_probes.Add(temp_collisions_);
+    return temp_collisions_;
+  }
+
+  /**
+   * @brief look up in without throwing; reports the groups taken whether or
+   *        not it was found. Find writes nothing, so any number of threads
+   *        may call it at once while no thread modifies the table; its groups
+   *        are not added to TotalCollisions. in may be any key type that
+   *        lookup_key.h can hash, e.g. a std::string_view into a string table.
+   *
+   * @param in
+   * @return LookupResult
+   */
+  template <typename Key>
+  LookupResult Find(const Key &in) const
+  {
+    int probes;
+    bool found = FindPos(in, probes) != slots_.size();
+    return LookupResult{found, probes};
+  }
+
+  /**
+   * @brief Find every key in [first, last), writing one LookupResult per key
+   *        to results. Each batch of keys is hashed and has its home groups
+   *        prefetched before any of them is probed, so their cache misses
+   *        overlap instead of being paid one at a time.
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    size_t hashes[kPrefetchBatch];
+    while (first != last)
+    {
+      ForwardIt batch = first;
+      size_t count = 0;
+      for (; first != last && count < kPrefetchBatch; ++first, ++count)
+      {
+        const auto &key = *first;
+        hashes[count] = Hash(key);
+        size_t group = (hashes[count] >> 7) & group_mask_;
+        Prefetch(&control_[group * kGroupWidth]);
+        Prefetch(&slots_[group * kGroupWidth]);
+      }
+      for (size_t x = 0; x < count; ++x, ++batch)
+      {
+        int probes;
+        bool found = FindPos(*batch, hashes[x], probes) != slots_.size();
+        *results++ = LookupResult{found, probes};
+      }
+    }
+    return results;
+  }
+
+  /**
+   * @brief insert new element into HashTable
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Insert(const HashedObj &x)
+  {
+    this->total_elements_++;
+    // Hash once for both the lookup and the placement.
+    size_t hash = Hash(x);
+    int probes;
+    size_t current_pos = FindPos(x, hash, probes);
+    temp_collisions_ = probes;
+    collisions_ += (probes - 1);
+    stats_.insert_probes.Add(probes);
+    if (current_pos != slots_.size())
+      return false;
+
+    Place(x, hash);
+    ++current_size_;
+
+    // Keep at least one in eight slots empty so unsuccessful probes terminate.
+    if (current_size_ + deleted_size_ > slots_.size() - slots_.size() / 8)
+    {
+      Rehash();
+    }
+    return true;
+  }
+
+  /**
+   * @brief find and remove element x
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Remove(const HashedObj &x)
+  {
+    size_t current_pos = FindPos(x);
+    if (current_pos == slots_.size())
+      return false;
+
+    // A group that still has an empty slot ends every probe that reaches it,
+    // so the freed slot can go straight back to empty instead of a tombstone.
+    size_t group = current_pos / kGroupWidth;
+    if (MatchEmpty(group) != 0)
+    {
+      control_[current_pos] = kEmpty;
+    }
+    else
+    {
+      control_[current_pos] = kDeleted;
+      deleted_size_++;
+    }
+    current_size_--;
+    return true;
+  }
+
+  /**
+   * @brief return total collisions that occured while probing
+   *
+   * @return int
+   */
+  int TotalCollisions()
+  {
+    return collisions_;
+  }
+
+  /**
+   * @brief returns total elements in HashTable
+   *
+   * @return int
+   */
+  int TotalElements()
+  {
+    return this->total_elements_;
+  }
+
+  /**
+   * @brief returns internal HashTable allocated size
+   *
+   * @return int
+   */
+  int InternalSize()
+  {
+    return this->slots_.size();
+  }
+
+  /**
+   * @brief returns the table's health statistics; see table_stats.h. Probe
+   *        lengths here count groups, not slots.
+   *
+   * @return TableStats
+   */
+  TableStats Stats() const
+  {
+    TableStats stats = stats_;
+    stats.elements = current_size_;
+    stats.slots = slots_.size();
+    stats.tombstones = deleted_size_;
+    stats.bytes_used = control_.capacity() * sizeof(int8_t) + slots_.capacity() * sizeof(HashedObj);
+    stats.cluster_sizes = ClusterSizes(control_.size(), [this](size_t pos)
+                                       { return control_[pos] != kEmpty; });
+    return stats;
+  }
+  int temp_collisions_ = 0;
+
+private:
+  // Control byte values. Full slots store the low 7 bits of the hash, so
+  // their top bit is always clear.
+  enum ControlByte : int8_t
+  {
+    kEmpty = -128,
+    kDeleted = -2
+  };
+
+  /**
+   * @brief error object if a key is not found
+   *
+   */
+  struct KeyError : public std::exception
+  {
+    const char *what() const throw()
+    {
+      return "Key Not Found";
+    }
+  };
+
+  std::vector<int8_t> control_;
+  std::vector<HashedObj> slots_;
+  size_t group_mask_;
+  size_t current_size_;
+  size_t deleted_size_;
+  size_t total_elements_ = 0;
+  size_t collisions_ = 0;
+  // Recorded parts of Stats().
+  TableStats stats_;
+
+  /**
+   * @brief returns a bitmask with bit i set when control byte i of group
+   *        equals value
+   *
+   * @param group
+   * @param value
+   * @return uint32_t
+   */
+  uint32_t Match(size_t group, int8_t value) const
+  {
+    const int8_t *ctrl = &control_[group * kGroupWidth];
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; i++)
+      if (ctrl[i] == value)
+        mask |= (1u << i);
+    return mask;
+#endif
+  }
+
+  /**
+   * @brief returns a bitmask of the empty slots in group
+   *
+   * @param group
+   * @return uint32_t
+   */
+  uint32_t MatchEmpty(size_t group) const
+  {
+    return Match(group, kEmpty);
+  }
+
+  /**
+   * @brief returns a bitmask of the empty or deleted slots in group
+   *
+   * @param group
+   * @return uint32_t
+   */
+  uint32_t MatchFree(size_t group) const
+  {
+    const int8_t *ctrl = &control_[group * kGroupWidth];
+#ifdef __SSE2__
+    // Empty and deleted are the only control bytes with the top bit set.
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return _mm_movemask_epi8(bytes);
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; i++)
+      if (ctrl[i] < 0)
+        mask |= (1u << i);
+    return mask;
+#endif
+  }
+
+  /**
+   * @brief returns the index of the lowest set bit in mask, which is not 0;
+   *        falls back to a loop on compilers without a count-trailing-zeros
+   *        builtin
+   *
+   * @param mask
+   * @return size_t
+   */
+  static size_t LowestBit(uint32_t mask)
+  {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    size_t bit = 0;
+    for (; (mask & 1) == 0; mask >>= 1)
+      bit++;
+    return bit;
+#endif
+  }
+
+  /**
+   * @brief returns the position of the object x in the HashMap, or
+   *        slots_.size() if it is absent
+   *
+   * @param x
+   * @return size_t
+   */
+  size_t FindPos(const HashedObj &x)
+  {
+    int probes;
+    size_t current_pos = FindPos(x, probes);
+    temp_collisions_ = probes;
+    collisions_ += (probes - 1);
+    return current_pos;
+  }
+
+  /**
+   * @brief the probing loop behind FindPos. It only reads the table and
+   *        reports the groups it examined through probes.
+   *
+   * @param x
+   * @param probes set to the number of groups examined
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, int &probes) const
+  {
+    return FindPos(x, Hash(x), probes);
+  }
+
+  /**
+   * @brief the probing loop for a caller that already has hash == Hash(x)
+   *
+   * @param x
+   * @param hash
+   * @param probes set to the number of groups examined
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, size_t hash, int &probes) const
+  {
+    int8_t fragment = static_cast<int8_t>(hash & 0x7f);
+    size_t group = (hash >> 7) & group_mask_;
+    probes = 1;
+    // Triangular steps over a power-of-two group count visit every group.
+    for (size_t step = 1;; step++)
+    {
+      for (uint32_t mask = Match(group, fragment); mask != 0; mask &= mask - 1)
+      {
+        size_t current_pos = group * kGroupWidth + LowestBit(mask);
+        if (slots_[current_pos] == x)
+          return current_pos;
+      }
+      if (MatchEmpty(group) != 0)
+        break;
+      probes++;
+      group = (group + step) & group_mask_;
+    }
+    return slots_.size();
+  }
+
+  /**
+   * @brief stores x, known to be absent, in the first free slot of its probe
+   *        sequence
+   *
+   * @param x
+   * @param hash
+   */
+  template <typename Obj>
+  void Place(Obj &&x, size_t hash)
+  {
+    size_t group = (hash >> 7) & group_mask_;
+    uint32_t mask;
+    for (size_t step = 1; (mask = MatchFree(group)) == 0; step++)
+      group = (group + step) & group_mask_;
+
+    size_t current_pos = group * kGroupWidth + LowestBit(mask);
+    if (control_[current_pos] == kDeleted)
+      deleted_size_--;
+    control_[current_pos] = static_cast<int8_t>(hash & 0x7f);
+    slots_[current_pos] = std::forward<Obj>(x);
+  }
+
+  /**
+   * @brief when the table reaches load capacity, reinsert all elements,
+   *        dropping any tombstones. The group count doubles unless
+   *        tombstones filled the table while live elements hold at most half
+   *        the slots; then it stays, as dropping them frees enough.
+   *
+   */
+  void Rehash()
+  {
+    if (current_size_ <= slots_.size() / 2)
+      Rehash(group_mask_ + 1);
+    else
+      Rehash(2 * (group_mask_ + 1));
+  }
+
+  /**
+   * @brief resize the table to groups groups and reinsert all elements
+   *
+   * @param groups a power of two
+   */
+  void Rehash(size_t groups)
+  {
+    RehashTimer timer(stats_);
+    std::vector<int8_t> old_control = std::move(control_);
+    std::vector<HashedObj> old_slots = std::move(slots_);
+
+    Allocate(groups);
+    for (size_t i = 0; i < old_slots.size(); i++)
+    {
+      if (old_control[i] >= 0)
+      {
+        Place(std::move(old_slots[i]), Hash(old_slots[i]));
+        ++current_size_;
+      }
+    }
+  }
+
+  /**
+   * @brief sizes the table to hold groups groups, all empty
+   *
+   * @param groups a power of two
+   */
+  void Allocate(size_t groups)
+  {
+    control_.assign(groups * kGroupWidth, kEmpty);
+    slots_.assign(groups * kGroupWidth, HashedObj{});
+    group_mask_ = groups - 1;
+    current_size_ = 0;
+    deleted_size_ = 0;
+  }
+
+  /**
+   * @brief returns the smallest power-of-two group count covering size slots
+   *
+   * @param size
+   * @return size_t
+   */
+  static size_t GroupCount(size_t size)
+  {
+    size_t groups = 1;
+    while (groups * kGroupWidth < size)
+      groups *= 2;
+    return groups;
+  }
+
+  /**
+   * @brief returns the fewest slots that hold n elements below the 7/8 load cap
+   *
+   * @param n
+   * @return size_t
+   */
+  static size_t MinimumSlots(size_t n)
+  {
+    return n + n / 7 + 1;
+  }
+
+  /**
+   * @brief returns the full hash of x, which is a HashedObj or a lookup
+   *        key equal to one
+   *
+   * @param x
+   * @return size_t
+   */
+  template <typename Key>
+  static size_t Hash(const Key &x)
+  {
+    static Hasher hf;
+    return HashLookupKey(hf, x);
+  }
+};
+
+#endif // GROUP_PROBING_H
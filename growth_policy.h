@@ -0,0 +1,261 @@
+/**
+ * @file growth_policy.h
+ * @author Moududur Rahman
+ * @brief GrowthPolicy decides when HashTableLinear, HashTable and
+ *        HashTableDouble resize, and to what size
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * By default a table doubles once more than half its slots are occupied,
+ * which keeps probes short at the cost of half the memory. A fixed policy
+ * moves that threshold (max_load_factor), the step (growth_factor) and lets
+ * Remove shrink a table that has emptied out (shrink_load_factor).
+ *
+ * An adaptive policy grows on what the inserts actually cost instead. It
+ * splits the inserts into windows of a size that scales with the table
+ * (1/32 of its slots, at least 64 inserts) and grows once two windows in a
+ * row ran over target: their average probe length exceeded it, or more than
+ * 1/16 of their inserts probed past a maximum. One long probe, or one short
+ * run of collisions, does not grow the table. A good hash then runs the
+ * table fuller than a fixed threshold would dare; max_load_factor remains
+ * as a hard ceiling.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef GROWTH_POLICY_H
+#define GROWTH_POLICY_H
+
+#include <algorithm>
+#include <cstddef>
+
+class GrowthPolicy
+{
+public:
+  // Highest load any policy may set, so that unsuccessful probes always
+  // reach an empty slot, and the lowest, so that a table never grows on
+  // every insert.
+  static constexpr double kLoadFactorLimit = 0.95;
+  static constexpr double kMinLoadFactor = 0.05;
+  // Largest step a resize may take.
+  static constexpr double kMaxGrowthFactor = 16;
+
+  /**
+   * @brief Construct a new fixed Growth Policy object. Out of range values
+   *        (NaN included) are clamped; see the parameters.
+   *
+   * @param max_load_factor grow once more than this fraction of the slots
+   *        are occupied (live or deleted); kept within [kMinLoadFactor,
+   *        kLoadFactorLimit]
+   * @param growth_factor each resize multiplies the slot count by this;
+   *        kept within [1.25, kMaxGrowthFactor]
+   * @param shrink_load_factor Remove shrinks the table once fewer than this
+   *        fraction of the slots hold live elements; 0 never shrinks. Kept
+   *        below half the load a table starts at after growing, so a table
+   *        never shrinks straight after it grows.
+   */
+  explicit GrowthPolicy(double max_load_factor = 0.5, double growth_factor = 2,
+                        double shrink_load_factor = 0)
+      : max_load_factor_{ValidLoadFactor(max_load_factor)},
+        growth_factor_{Clamp(growth_factor, 1.25, kMaxGrowthFactor)},
+        shrink_load_factor_{shrink_load_factor}
+  {
+    ClampShrinkLoadFactor();
+  }
+
+  /**
+   * @brief returns an adaptive policy
+   *
+   * @param target_average_probes a window runs over once its average insert
+   *        probe length exceeds this; 0 ignores the average
+   * @param target_max_probes a window runs over once more than 1/16 of its
+   *        inserts take more probes than this; 0 ignores long inserts
+   * @param max_load_factor grow past this load whatever the probe lengths
+   * @param growth_factor
+   * @param shrink_load_factor
+   * @return GrowthPolicy
+   */
+  static GrowthPolicy Adaptive(double target_average_probes, int target_max_probes,
+                               double max_load_factor = 0.9, double growth_factor = 2,
+                               double shrink_load_factor = 0)
+  {
+    GrowthPolicy policy(max_load_factor, growth_factor, shrink_load_factor);
+    policy.target_average_probes_ = target_average_probes;
+    policy.target_max_probes_ = target_max_probes;
+    return policy;
+  }
+
+  double MaxLoadFactor() const
+  {
+    return max_load_factor_;
+  }
+
+  bool IsAdaptive() const
+  {
+    return target_average_probes_ > 0 || target_max_probes_ > 0;
+  }
+
+  /**
+   * @brief lowers the ceiling on the load factor to cap, for a table whose
+   *        probing needs it
+   *
+   * @param cap
+   */
+  void CapLoadFactor(double cap)
+  {
+    max_load_factor_ = std::min(max_load_factor_, ValidLoadFactor(cap));
+    ClampShrinkLoadFactor();
+  }
+
+  /**
+   * @brief returns load_factor clamped to [kMinLoadFactor, kLoadFactorLimit],
+   *        for tables that take a maximum load factor of their own
+   *
+   * @param load_factor
+   * @return double
+   */
+  static double ValidLoadFactor(double load_factor)
+  {
+    return Clamp(load_factor, kMinLoadFactor, kLoadFactorLimit);
+  }
+
+  /**
+   * @brief called after each insert; returns if the table should grow
+   *
+   * @param occupied slots holding live or deleted elements
+   * @param slots
+   * @param probes slots the insert examined
+   * @return true
+   * @return false
+   */
+  bool ShouldGrow(size_t occupied, size_t slots, int probes)
+  {
+    if (occupied > slots * max_load_factor_)
+      return true;
+    if (!IsAdaptive())
+      return false;
+
+    ++window_inserts_;
+    window_probes_ += probes;
+    if (target_max_probes_ > 0 && probes > target_max_probes_)
+      ++window_outliers_;
+    if (window_inserts_ < std::max(kMinimumWindow, slots / kWindowsPerTable))
+      return false;
+
+    // Below a quarter full, long probes point at a poor hash, which more
+    // slots would not fix.
+    bool over = occupied >= slots / 4 &&
+                ((target_average_probes_ > 0 &&
+                  window_probes_ > target_average_probes_ * window_inserts_) ||
+                 window_outliers_ * kOutlierFraction > window_inserts_);
+    windows_over_ = over ? windows_over_ + 1 : 0;
+    window_inserts_ = window_probes_ = window_outliers_ = 0;
+    return windows_over_ >= kWindowsToGrow;
+  }
+
+  /**
+   * @brief called after each remove; returns if the table should shrink
+   *
+   * @param live slots holding live elements
+   * @param slots
+   * @return true
+   * @return false
+   */
+  bool ShouldShrink(size_t live, size_t slots) const
+  {
+    return shrink_load_factor_ > 0 && slots > kMinimumShrinkSlots &&
+           live < slots * shrink_load_factor_;
+  }
+
+  /**
+   * @brief returns the slot count to grow a table of slots slots to
+   *
+   * @param slots
+   * @return size_t
+   */
+  size_t GrownSize(size_t slots) const
+  {
+    return slots * growth_factor_;
+  }
+
+  /**
+   * @brief returns the slot count to shrink a table of slots slots holding
+   *        live elements to, which never exceeds max_load_factor
+   *
+   * @param live
+   * @param slots
+   * @return size_t
+   */
+  size_t ShrunkSize(size_t live, size_t slots) const
+  {
+    return std::max<size_t>(slots / growth_factor_, SlotsFor(live));
+  }
+
+  /**
+   * @brief returns the slot count that holds n elements without growing
+   *
+   * @param n
+   * @return size_t
+   */
+  size_t SlotsFor(size_t n) const
+  {
+    return n / max_load_factor_ + 1;
+  }
+
+  /**
+   * @brief called when the table is resized; restarts the windows
+   *
+   */
+  void Resized()
+  {
+    window_inserts_ = window_probes_ = window_outliers_ = 0;
+    windows_over_ = 0;
+  }
+
+private:
+  // An adaptive window spans 1/kWindowsPerTable of the slots, and at least
+  // kMinimumWindow inserts; the table grows after kWindowsToGrow windows in
+  // a row run over, where more than 1/kOutlierFraction long inserts is over.
+  static constexpr size_t kMinimumWindow = 64;
+  static constexpr size_t kWindowsPerTable = 32;
+  static constexpr size_t kOutlierFraction = 16;
+  static constexpr int kWindowsToGrow = 2;
+  static const size_t kMinimumShrinkSlots = 101;
+
+  double max_load_factor_;
+  double growth_factor_;
+  double shrink_load_factor_;
+  double target_average_probes_ = 0;
+  int target_max_probes_ = 0;
+
+  size_t window_inserts_ = 0;
+  size_t window_probes_ = 0;
+  size_t window_outliers_ = 0;
+  int windows_over_ = 0;
+
+  /**
+   * @brief returns value clamped to [low, high]; NaN becomes low
+   *
+   * @param value
+   * @param low
+   * @param high
+   * @return double
+   */
+  static double Clamp(double value, double low, double high)
+  {
+    return value > low ? std::min(value, high) : low;
+  }
+
+  /**
+   * @brief keeps shrink_load_factor_ below half of max_load_factor_ /
+   *        growth_factor_
+   *
+   */
+  void ClampShrinkLoadFactor()
+  {
+    shrink_load_factor_ = Clamp(shrink_load_factor_, 0, max_load_factor_ / growth_factor_ / 2);
+  }
+};
+
+#endif // GROWTH_POLICY_H
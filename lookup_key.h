@@ -0,0 +1,54 @@
+/**
+ * @file lookup_key.h
+ * @author Moududur Rahman
+ * @brief Hashing for lookup keys of a different type than the table's
+ *        HashedObj
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * The tables' Find, FindBatch and Contains take any key that compares with a
+ * HashedObj through == and that HashLookupKey hashes to the same value the
+ * table's Hasher gives the equal HashedObj. That lets a std::string table be
+ * probed with a std::string_view (wrap a char buffer in one) without building
+ * a std::string, and so without allocating.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef LOOKUP_KEY_H
+#define LOOKUP_KEY_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief returns hf's hash of key; covers every Hasher that accepts key
+ *        directly, such as the string hashers in string_hashers.h
+ *
+ * @param hf
+ * @param key
+ * @return size_t
+ */
+template <typename Hasher, typename Key>
+size_t HashLookupKey(const Hasher &hf, const Key &key)
+{
+  return hf(key);
+}
+
+/**
+ * @brief std::hash<std::string> only takes a std::string, but the standard
+ *        requires std::hash<std::string_view> to give the same value for the
+ *        same characters
+ *
+ * @param key
+ * @return size_t
+ */
+inline size_t HashLookupKey(const std::hash<std::string> &, std::string_view key)
+{
+  return std::hash<std::string_view>()(key);
+}
+
+#endif // LOOKUP_KEY_H
@@ -0,0 +1,162 @@
+/**
+ * @file mapped_dictionary.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for
+ *        MappedDictionary, a word list loaded by memory-mapping its file
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * The dictionary file is mapped read-only and split on whitespace in place.
+ * Each word goes into a HashTableDouble keyed by std::string_view pointing
+ * straight into the mapping, so loading allocates nothing per word. The
+ * mapping lives exactly as long as the MappedDictionary that owns it.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef MAPPED_DICTIONARY_H
+#define MAPPED_DICTIONARY_H
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "double_hashing.h"
+
+class MappedDictionary
+{
+public:
+  typedef HashTableDouble<std::string_view> Table;
+
+  /**
+   * @brief Construct a new Mapped Dictionary object from the words in
+   *        dictionary_file. If the file can't be mapped the dictionary is
+   *        left empty and IsOpen() returns false.
+   *
+   * @param dictionary_file
+   * @param r_value double hashing r value of the underlying table
+   */
+  explicit MappedDictionary(const std::string &dictionary_file, int r_value = 73)
+      : table_(r_value, 101)
+  {
+    int fd = open(dictionary_file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED)
+      {
+        data_ = static_cast<const char *>(mapping);
+        size_ = info.st_size;
+      }
+    }
+    close(fd);
+
+    if (data_ != nullptr)
+    {
+      madvise(const_cast<char *>(data_), size_, MADV_SEQUENTIAL);
+      Load();
+    }
+  }
+
+  MappedDictionary(const MappedDictionary &) = delete;
+  MappedDictionary &operator=(const MappedDictionary &) = delete;
+
+  /**
+   * @brief Destroy the Mapped Dictionary object, unmapping the file. Any
+   *        string_view handed out by the table dangles after this.
+   *
+   */
+  ~MappedDictionary()
+  {
+    if (data_ != nullptr)
+      munmap(const_cast<char *>(data_), size_);
+  }
+
+  /**
+   * @brief returns if the dictionary file was mapped successfully
+   *
+   * @return true
+   * @return false
+   */
+  bool IsOpen() const
+  {
+    return data_ != nullptr;
+  }
+
+  /**
+   * @brief look up word without throwing
+   *
+   * @param word
+   * @return Table::LookupResult
+   */
+  Table::LookupResult Find(std::string_view word) const
+  {
+    return table_.Find(word);
+  }
+
+  /**
+   * @brief look up every word in [first, last), writing one LookupResult per
+   *        word to results; see HashTableDouble::FindBatch
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    return table_.FindBatch(first, last, results);
+  }
+
+  /**
+   * @brief returns the underlying table
+   *
+   * @return Table&
+   */
+  Table &GetTable()
+  {
+    return table_;
+  }
+
+private:
+  Table table_;
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+  /**
+   * @brief sizes the table from the number of lines, then inserts every
+   *        whitespace separated word of the mapping
+   *
+   */
+  void Load()
+  {
+    const char *end = data_ + size_;
+    table_.Reserve(std::count(data_, end, '\n') + 1);
+
+    const char *current = data_;
+    while (current != end)
+    {
+      while (current != end && std::isspace(static_cast<unsigned char>(*current)))
+        current++;
+      const char *word = current;
+      while (current != end && !std::isspace(static_cast<unsigned char>(*current)))
+        current++;
+      if (current != word)
+        table_.Insert(std::string_view(word, current - word));
+    }
+  }
+};
+
+#endif // MAPPED_DICTIONARY_H
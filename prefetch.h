@@ -0,0 +1,41 @@
+/**
+ * @file prefetch.h
+ * @author Moududur Rahman
+ * @brief Software prefetch helper used by the tables' batched lookups
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * A lookup in a large table usually misses the cache on its home slot, and a
+ * loop of independent lookups pays those misses one after another. The
+ * FindBatch calls hash kPrefetchBatch keys and prefetch all of their home
+ * slots before probing any of them, so the misses overlap.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <cstddef>
+
+// Keys hashed and prefetched together by FindBatch. Enough to cover DRAM
+// latency, few enough that the hashes stay in registers and L1.
+const size_t kPrefetchBatch = 16;
+
+/**
+ * @brief hints that address will soon be read; does nothing on compilers
+ *        without a prefetch builtin
+ *
+ * @param address
+ */
+inline void Prefetch(const void *address)
+{
+#if defined(__GNUC__)
+  __builtin_prefetch(address, 0, 3);
+#else
+  (void)address;
+#endif
+}
+
+#endif // PREFETCH_H
@@ -17,9 +17,18 @@
 #include <algorithm>
 #include <functional>
 #include <exception>
+#include <iterator>
+#include <type_traits>
+
+#include "lookup_key.h"
+#include "prefetch.h"
+#include "growth_policy.h"
+#include "size_policy.h"
+#include "table_stats.h"
 
 // Quadratic probing implementation.
-template <typename HashedObj>
+template <typename HashedObj, typename SizePolicy = PrimeSizePolicy,
+          typename Hasher = std::hash<HashedObj>>
 class HashTable
 {
 public:
@@ -30,15 +39,49 @@ public:
     DELETED
   };
 
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
   /**
    * @brief Construct a new Hash Table Double object
    * 
    * @param size 
    */
-  explicit HashTable(size_t size = 101) : array_(NextPrime(size))
+  explicit HashTable(size_t size = 101) : array_(size_policy_.Resize(size))
+  {
+    MakeEmpty();
+  }
+
+  /**
+   * @brief Construct a new Hash Table object sized once for the range
+   *        [first, last) and filled from it
+   * 
+   * @param first 
+   * @param last 
+   */
+  template <typename ForwardIt,
+            typename = typename std::enable_if<!std::is_integral<ForwardIt>::value>::type>
+  HashTable(ForwardIt first, ForwardIt last)
+      : array_(size_policy_.Resize(2 * std::distance(first, last) + 1))
   {
     MakeEmpty();
+    for (; first != last; ++first)
+      Insert(*first);
   }
+
   /**
    * @brief returns if x is in this HashTable object
    * 
@@ -46,9 +89,10 @@ public:
    * @return true 
    * @return false 
    */
-  bool Contains(const HashedObj &x) const
+  template <typename Key>
+  bool Contains(const Key &x) const
   {
-    return IsActive(FindPos(x));
+    return Find(x).found;
   }
 
   /**
@@ -57,11 +101,66 @@ public:
    */
   void MakeEmpty()
   {
+    std::vector<HashEntry>().swap(old_array_);
     current_size_ = 0;
+    deleted_size_ = 0;
     for (auto &entry : array_)
       entry.info_ = EMPTY;
   }
 
+  /**
+   * @brief size the table once so that n elements fit without any further
+   *        rehashing
+   * 
+   * @param n 
+   */
+  void Reserve(size_t n)
+  {
+    size_t needed = growth_policy_.SlotsFor(n);
+    if (needed > array_.size())
+      Rehash(needed);
+  }
+
+  /**
+   * @brief grow the table to at least slots slots (rounded up the way the
+   *        table sizes itself) and rehash every element into it. Reserve
+   *        takes an element count instead.
+   * 
+   * @param slots 
+   */
+  void ReserveSlots(size_t slots)
+  {
+    if (slots > array_.size())
+      Rehash(slots);
+  }
+
+  /**
+   * @brief choose how growth is done. With 0 (the default) the Insert that
+   *        crosses the load cap rehashes every entry at once; otherwise the
+   *        old array is kept and each Insert, Get or Remove moves
+   *        buckets_per_operation of its buckets into the new one.
+   * 
+   * @param buckets_per_operation 
+   */
+  void SetIncrementalRehash(size_t buckets_per_operation)
+  {
+    migrate_step_ = buckets_per_operation;
+  }
+
+  /**
+   * @brief choose when the table grows and shrinks; see growth_policy.h.
+   *        The default doubles the table once it is more than half full.
+   * 
+   * @param policy 
+   */
+  void SetGrowthPolicy(const GrowthPolicy &policy)
+  {
+    growth_policy_ = policy;
+    // Quadratic probing only reaches half the slots of a prime-sized
+    // table, so past half full an insert may find no empty slot.
+    growth_policy_.CapLoadFactor(0.5);
+  }
+
   /**
    * @brief return how many probes it took to find in, otherwise throw an exception
    * 
@@ -70,14 +169,68 @@ public:
    */
   int Get(const HashedObj &in)
   {
-    size_t current_pos = FindPos(in);
-    if (!IsActive(current_pos))
+    if (FindEntry(in) == nullptr)
     {
+      stats_.miss_probes.Add(temp_collisions_);
       throw KeyError();
     }
+    stats_.hit_probes.Add(temp_collisions_);
     return temp_collisions_;
   }
 
+  /**
+   * @brief look up in without throwing; reports the probes taken whether or
+   *        not it was found. Find writes nothing, so any number of threads
+   *        may call it at once while no thread modifies the table; its probes
+   *        are not added to TotalCollisions. in may be any key type that
+   *        lookup_key.h can hash, e.g. a std::string_view into a string table.
+   *
+   * @param in
+   * @return LookupResult
+   */
+  template <typename Key>
+  LookupResult Find(const Key &in) const
+  {
+    int probes;
+    bool found = FindEntry(in, probes) != nullptr;
+    return LookupResult{found, probes};
+  }
+
+  /**
+   * @brief Find every key in [first, last), writing one LookupResult per key
+   *        to results. Each batch of keys is hashed and has its home slots
+   *        prefetched before any of them is probed, so their cache misses
+   *        overlap instead of being paid one at a time.
+   * 
+   * @param first 
+   * @param last 
+   * @param results 
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    size_t hashes[kPrefetchBatch];
+    while (first != last)
+    {
+      ForwardIt batch = first;
+      size_t count = 0;
+      for (; first != last && count < kPrefetchBatch; ++first, ++count)
+      {
+        const auto &key = *first;
+        hashes[count] = Hash(key);
+        Prefetch(&array_[size_policy_.Index(hashes[count])]);
+      }
+      for (size_t x = 0; x < count; ++x, ++batch)
+      {
+        int probes;
+        bool found = FindEntry(*batch, hashes[x], probes) != nullptr;
+        *results++ = LookupResult{found, probes};
+      }
+    }
+    return results;
+  }
+
   /**
    * @brief insert new element into HashTable
    * 
@@ -87,25 +240,12 @@ public:
    */
   bool Insert(const HashedObj &x)
   {
-    this->total_elements_++;
-    // Insert x as active
-    size_t current_pos = FindPos(x);
-    if (IsActive(current_pos))
-      return false;
-
-    array_[current_pos].element_ = x;
-    array_[current_pos].info_ = ACTIVE;
-
-    // Rehash; see Section 5.5
-    if (++current_size_ > array_.size() / 2)
-    {
-      Rehash();
-    }
-    return true;
+    return InsertNew(x);
   }
 
   /**
-   * @brief r value insert function for rehashing
+   * @brief insert new element into HashTable, moving it in rather than
+   *        copying it
    * 
    * @param x 
    * @return true 
@@ -113,25 +253,13 @@ public:
    */
   bool Insert(HashedObj &&x)
   {
-    // Insert x as active
-    size_t current_pos = FindPos(x);
-    if (IsActive(current_pos))
-      return false;
-
-    array_[current_pos] = std::move(x);
-    array_[current_pos].info_ = ACTIVE;
-
-    // Rehash; see Section 5.5
-    if (++current_size_ > array_.size() / 2)
-    {
-      Rehash();
-    }
-
-    return true;
+    return InsertNew(std::move(x));
   }
 
   /**
-   * @brief find and remove element x
+   * @brief find and remove element x. The slot becomes a tombstone; once
+   *        tombstones take up more than an eighth of the table it is rebuilt
+   *        at the same size to clear them.
    * 
    * @param x 
    * @return true 
@@ -139,14 +267,40 @@ public:
    */
   bool Remove(const HashedObj &x)
   {
-    size_t current_pos = FindPos(x);
-    if (!IsActive(current_pos))
+    HashEntry *entry = FindEntry(x);
+    if (entry == nullptr)
       return false;
 
-    array_[current_pos].info_ = DELETED;
+    entry->info_ = DELETED;
+    if (InOldArray(entry))
+    {
+      // The old array is discarded once migrated, so its tombstones don't count.
+      current_size_--;
+      return true;
+    }
+
+    size_t live = current_size_ - ++deleted_size_;
+    if (growth_policy_.ShouldShrink(live, array_.size()))
+    {
+      Rehash(growth_policy_.ShrunkSize(live, array_.size()));
+    }
+    else if (deleted_size_ > array_.size() / 8)
+    {
+      Rehash(array_.size());
+    }
     return true;
   }
 
+  /**
+   * @brief returns the number of tombstones left by Remove
+   * 
+   * @return int 
+   */
+  int TotalTombstones()
+  {
+    return this->deleted_size_;
+  }
+
   /**
    * @brief return total collisions that occured while probing
    * 
@@ -176,22 +330,45 @@ public:
   {
     return this->array_.size();
   }
+  /**
+   * @brief returns the table's health statistics; see table_stats.h
+   * 
+   * @return TableStats 
+   */
+  TableStats Stats() const
+  {
+    TableStats stats = stats_;
+    stats.elements = current_size_ - deleted_size_;
+    stats.slots = array_.size();
+    for (const auto &table : {&array_, &old_array_})
+    {
+      stats.tombstones += std::count_if(table->begin(), table->end(), [](const HashEntry &entry)
+                                        { return entry.info_ == DELETED; });
+      stats.bytes_used += table->capacity() * sizeof(HashEntry);
+    }
+    stats.cluster_sizes = ClusterSizes(array_.size(), [this](size_t pos)
+                                       { return array_[pos].info_ != EMPTY; });
+    return stats;
+  }
   int temp_collisions_ = 0;
 private:
   /**
-   * @brief metadata associates with the object being hashed
+   * @brief metadata associates with the object being hashed. hash_ caches the
+   *        full hash of element_, so probes compare it before the element and
+   *        Rehash never recomputes it.
    * 
    */
   struct HashEntry
   {
     HashedObj element_;
     EntryType info_;
+    size_t hash_;
 
     HashEntry(const HashedObj &e = HashedObj{}, EntryType i = EMPTY)
-        : element_{e}, info_{i} {}
+        : element_{e}, info_{i}, hash_{0} {}
 
     HashEntry(HashedObj &&e, EntryType i = EMPTY)
-        : element_{std::move(e)}, info_{i} {}
+        : element_{std::move(e)}, info_{i}, hash_{0} {}
   };
 
   /**
@@ -206,10 +383,23 @@ private:
     }
   };
 
+  // Declared ahead of the arrays so constructors can size them through it.
+  SizePolicy size_policy_;
+  SizePolicy old_size_policy_;
   std::vector<HashEntry> array_;
+  // Entries not yet moved by an incremental rehash, and the next bucket to move.
+  std::vector<HashEntry> old_array_;
+  size_t migrate_pos_ = 0;
+  size_t migrate_step_ = 0;
+  // Occupied slots in both arrays, tombstones included.
   size_t current_size_;
+  // Tombstones in array_.
+  size_t deleted_size_ = 0;
   size_t total_elements_ = 0;
   size_t collisions_ = 0;
+  // Recorded parts of Stats().
+  TableStats stats_;
+  GrowthPolicy growth_policy_;
 
   /**
    * @brief returns the active metadata from a HashMap slot
@@ -223,6 +413,47 @@ private:
     return array_[current_pos].info_ == ACTIVE;
   }
 
+  /**
+   * @brief the insert behind both Insert overloads: x is copied or moved
+   *        into its slot only once it is known to be absent
+   * 
+   * @param x 
+   * @return true 
+   * @return false 
+   */
+  template <typename Obj>
+  bool InsertNew(Obj &&x)
+  {
+    this->total_elements_++;
+    // Insert x as active
+    MigrateBuckets(migrate_step_);
+    size_t hash = Hash(x);
+    size_t current_pos = FindPos(x, hash, array_, size_policy_);
+    int probes = temp_collisions_;
+    stats_.insert_probes.Add(probes);
+    if (IsActive(current_pos))
+      return false;
+    if (Migrating() && old_array_[FindPos(x, hash, old_array_, old_size_policy_)].info_ == ACTIVE)
+      return false;
+
+    // Re-inserting a removed key lands on its own tombstone, which
+    // current_size_ already counts.
+    if (array_[current_pos].info_ == DELETED)
+      --deleted_size_;
+    else
+      ++current_size_;
+    array_[current_pos].element_ = std::forward<Obj>(x);
+    array_[current_pos].info_ = ACTIVE;
+    array_[current_pos].hash_ = hash;
+
+    // Rehash; see Section 5.5
+    if (growth_policy_.ShouldGrow(current_size_, array_.size(), probes))
+    {
+      Rehash();
+    }
+    return true;
+  }
+
   /**
    * @brief returns the position of the object x in the HashMap
    * 
@@ -230,20 +461,62 @@ private:
    * @return size_t 
    */
   size_t FindPos(const HashedObj &x)
+  {
+    return FindPos(x, Hash(x), array_, size_policy_);
+  }
+
+  /**
+   * @brief returns the position of the object x in table, which is either
+   *        array_ or the old_array_ still being migrated
+   * 
+   * @param x 
+   * @param hash Hash(x)
+   * @param table 
+   * @param policy the size policy table was sized with
+   * @return size_t 
+   */
+  size_t FindPos(const HashedObj &x, size_t hash,
+                 const std::vector<HashEntry> &table, const SizePolicy &policy)
+  {
+    int probes;
+    size_t current_pos = FindPos(x, hash, table, policy, probes);
+    temp_collisions_ = probes;
+    collisions_ += (probes - 1);
+    return current_pos;
+  }
+
+  /**
+   * @brief the probing loop behind FindPos. It only reads the table and
+   *        reports the slots it examined through probes, so it is safe to
+   *        run from several threads at once.
+   * 
+   * @param x 
+   * @param hash Hash(x)
+   * @param table 
+   * @param policy the size policy table was sized with
+   * @param probes set to the number of slots examined
+   * @return size_t 
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, size_t hash,
+                 const std::vector<HashEntry> &table, const SizePolicy &policy,
+                 int &probes) const
   {
     size_t offset = 1;
-    size_t current_pos = InternalHash(x);
-    temp_collisions_ = 1;
-    while (array_[current_pos].info_ != EMPTY &&
-           array_[current_pos].element_ != x)
+    size_t current_pos = policy.Index(hash);
+    probes = 1;
+    while (table[current_pos].info_ != EMPTY &&
+           (table[current_pos].hash_ != hash ||
+            table[current_pos].element_ != x))
     {
-      temp_collisions_++;
+      probes++;
       current_pos += offset; // Compute ith probe.
-      offset += 2;
-      if (current_pos >= array_.size())
-        current_pos -= array_.size();
+      // Odd offsets give i^2, which reaches half of a prime table; steps of
+      // one give triangular numbers, which reach all of a power-of-two one.
+      offset += SizePolicy::kPowerOfTwo ? 1 : 2;
+      if (current_pos >= table.size())
+        current_pos -= table.size();
     }
-    collisions_ += (temp_collisions_ - 1);
     return current_pos;
   }
 
@@ -254,62 +527,196 @@ private:
    */
   void Rehash()
   {
-    std::vector<HashEntry> old_array = array_;
+    if (migrate_step_ == 0)
+    {
+      Rehash(growth_policy_.GrownSize(array_.size()));
+      return;
+    }
 
-    // Create new double-sized, empty table.
-    array_.resize(NextPrime(2 * old_array.size()));
-    for (auto &entry : array_)
-      entry.info_ = EMPTY;
+    // Incremental mode: keep the old array around and let later operations
+    // move its entries over a few buckets at a time.
+    RehashTimer timer(stats_);
+    FinishMigration();
+    old_array_ = std::move(array_);
+    old_size_policy_ = size_policy_;
+    array_.assign(size_policy_.Resize(growth_policy_.GrownSize(old_array_.size())), HashEntry{});
+    growth_policy_.Resized();
+    migrate_pos_ = 0;
+    current_size_ -= deleted_size_;
+    deleted_size_ = 0;
+  }
+
+  /**
+   * @brief resize the internal vector to at least min_size slots and reinsert
+   *        all elements
+   * 
+   * @param min_size 
+   */
+  void Rehash(size_t min_size)
+  {
+    RehashTimer timer(stats_);
+    FinishMigration();
+    std::vector<HashEntry> old_array = std::move(array_);
+
+    // Create new empty table.
+    array_.assign(size_policy_.Resize(min_size), HashEntry{});
+    growth_policy_.Resized();
 
     // Copy table over.
     current_size_ = 0;
+    deleted_size_ = 0;
     for (auto &entry : old_array)
       if (entry.info_ == ACTIVE)
-        Insert(std::move(entry.element_));
+      {
+        Reinsert(entry);
+        ++current_size_;
+      }
   }
 
   /**
-   * @brief returns the hash of object x
+   * @brief move an active entry from an old array into array_, reusing its
+   *        cached hash
    * 
-   * @param x 
-   * @return size_t 
+   * @param entry 
    */
-  size_t InternalHash(const HashedObj &x) const
+  void Reinsert(HashEntry &entry)
   {
-    static std::hash<HashedObj> hf;
-    return hf(x) % array_.size();
+    size_t current_pos = FindPos(entry.element_, entry.hash_, array_, size_policy_);
+    array_[current_pos] = std::move(entry);
   }
 
   /**
-   * @brief returns if an int n is prime
+   * @brief returns if an incremental rehash is still moving entries out of
+   *        old_array_
    * 
-   * @param n 
    * @return true 
    * @return false 
    */
-  bool IsPrime(size_t n)
+  bool Migrating() const
   {
-    if (n == 2 || n == 3)
-      return true;
+    return !old_array_.empty();
+  }
 
-    if (n == 1 || n % 2 == 0)
-      return false;
+  /**
+   * @brief move up to count buckets of old_array_ into array_. Moved slots
+   *        are left DELETED so probe chains through old_array_ stay intact.
+   * 
+   * @param count 
+   */
+  void MigrateBuckets(size_t count)
+  {
+    for (; count > 0 && migrate_pos_ < old_array_.size(); count--, migrate_pos_++)
+    {
+      HashEntry &entry = old_array_[migrate_pos_];
+      if (entry.info_ != ACTIVE)
+        continue;
+      Reinsert(entry);
+      entry.info_ = DELETED;
+    }
+    if (migrate_pos_ == old_array_.size())
+      std::vector<HashEntry>().swap(old_array_);
+  }
 
-    for (int i = 3; i * i <= n; i += 2)
-      if (n % i == 0)
-        return false;
+  /**
+   * @brief move whatever is left of old_array_ into array_
+   * 
+   */
+  void FinishMigration()
+  {
+    while (Migrating())
+      MigrateBuckets(old_array_.size());
+  }
 
-    return true;
+  /**
+   * @brief returns if entry lives in old_array_ rather than array_
+   * 
+   * @param entry 
+   * @return true 
+   * @return false 
+   */
+  bool InOldArray(const HashEntry *entry) const
+  {
+    return Migrating() && entry >= old_array_.data() &&
+           entry < old_array_.data() + old_array_.size();
   }
 
-  // Internal method to return a prime number at least as large as n.
-  int NextPrime(size_t n)
+  /**
+   * @brief returns the active entry holding x, or nullptr. While an
+   *        incremental rehash is in progress this also migrates a few buckets
+   *        and falls back to old_array_, adding up the probes of both searches.
+   * 
+   * @param x 
+   * @return HashEntry* 
+   */
+  HashEntry *FindEntry(const HashedObj &x)
+  {
+    MigrateBuckets(migrate_step_);
+    size_t hash = Hash(x);
+    size_t current_pos = FindPos(x, hash, array_, size_policy_);
+    if (IsActive(current_pos))
+      return &array_[current_pos];
+    if (!Migrating())
+      return nullptr;
+
+    int new_probes = temp_collisions_;
+    size_t old_pos = FindPos(x, hash, old_array_, old_size_policy_);
+    temp_collisions_ += new_probes;
+    if (old_array_[old_pos].info_ != ACTIVE)
+      return nullptr;
+    return &old_array_[old_pos];
+  }
+
+  /**
+   * @brief read-only FindEntry for Find: it migrates nothing, records nothing
+   *        in the table, and reports the probes of both searches through probes
+   * 
+   * @param x 
+   * @param probes 
+   * @return const HashEntry* 
+   */
+  template <typename Key>
+  const HashEntry *FindEntry(const Key &x, int &probes) const
+  {
+    return FindEntry(x, Hash(x), probes);
+  }
+
+  /**
+   * @brief read-only FindEntry for a caller that already has hash == Hash(x)
+   * 
+   * @param x 
+   * @param hash 
+   * @param probes 
+   * @return const HashEntry* 
+   */
+  template <typename Key>
+  const HashEntry *FindEntry(const Key &x, size_t hash, int &probes) const
+  {
+    size_t current_pos = FindPos(x, hash, array_, size_policy_, probes);
+    if (IsActive(current_pos))
+      return &array_[current_pos];
+    if (!Migrating())
+      return nullptr;
+
+    int new_probes = probes;
+    size_t old_pos = FindPos(x, hash, old_array_, old_size_policy_, probes);
+    probes += new_probes;
+    if (old_array_[old_pos].info_ != ACTIVE)
+      return nullptr;
+    return &old_array_[old_pos];
+  }
+
+  /**
+   * @brief returns the hash of x, which is a HashedObj or a lookup key equal
+   *        to one
+   * 
+   * @param x 
+   * @return size_t 
+   */
+  template <typename Key>
+  static size_t Hash(const Key &x)
   {
-    if (n % 2 == 0)
-      ++n;
-    while (!IsPrime(n))
-      n += 2;
-    return n;
+    static Hasher hf;
+    return HashLookupKey(hf, x);
   }
 };
 
@@ -0,0 +1,343 @@
+/**
+ * @file report_writer.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for ReportWriter,
+ *        the buffered writer behind spell_check's and create_and_test_hash's
+ *        per-word output
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Ending every reported word with std::endl costs a flush, and so a write
+ * system call, per word, which on large inputs outweighs the lookups.
+ * ReportWriter formats into its own buffer and hands it to the stream a
+ * block at a time; in line-flush mode, meant for watching a run
+ * interactively, it flushes after every line instead.
+ *
+ * Records (verdicts, corrections, lookups and statistics) can be written as
+ * the programs' usual text, as tab separated values whose first column names
+ * the record, or as JSON lines. ReportOptions::FromEnvironment picks these
+ * from REPORT_FORMAT (text, tsv or jsonl) and REPORT_FLUSH (line or block),
+ * since the programs' arguments are fixed by the assignment.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef REPORT_WRITER_H
+#define REPORT_WRITER_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class ReportFormat
+{
+  kText,
+  kTsv,
+  kJsonLines
+};
+
+/**
+ * @brief how a ReportWriter formats and flushes
+ *
+ */
+struct ReportOptions
+{
+  ReportFormat format = ReportFormat::kText;
+  bool line_flush = false;
+
+  /**
+   * @brief reads the options from REPORT_FORMAT and REPORT_FLUSH; unset or
+   *        unrecognised values keep the defaults
+   *
+   * @return ReportOptions
+   */
+  static ReportOptions FromEnvironment()
+  {
+    ReportOptions options;
+    if (const char *format = std::getenv("REPORT_FORMAT"))
+    {
+      if (std::string_view(format) == "tsv")
+        options.format = ReportFormat::kTsv;
+      else if (std::string_view(format) == "jsonl")
+        options.format = ReportFormat::kJsonLines;
+    }
+    if (const char *flush = std::getenv("REPORT_FLUSH"))
+      options.line_flush = std::string_view(flush) == "line";
+    return options;
+  }
+};
+
+class ReportWriter
+{
+public:
+  static const size_t kDefaultBufferSize = 64 * 1024;
+
+  /**
+   * @brief Construct a new Report Writer object writing to out
+   *
+   * @param out
+   * @param options
+   * @param buffer_size bytes collected before they are handed to out
+   */
+  explicit ReportWriter(std::ostream &out, ReportOptions options = ReportOptions(),
+                        size_t buffer_size = kDefaultBufferSize)
+      : out_{out}, options_{options}, buffer_size_{buffer_size}
+  {
+    buffer_.reserve(buffer_size_);
+  }
+
+  ReportWriter(const ReportWriter &) = delete;
+  ReportWriter &operator=(const ReportWriter &) = delete;
+
+  ~ReportWriter()
+  {
+    Flush();
+  }
+
+  ReportFormat Format() const
+  {
+    return options_.format;
+  }
+
+  /**
+   * @brief writes that word is, or is not, in the dictionary
+   *
+   * @param word
+   * @param correct
+   */
+  void Verdict(std::string_view word, bool correct)
+  {
+    switch (options_.format)
+    {
+    case ReportFormat::kText:
+      *this << word << (correct ? " is CORRECT" : " is INCORRECT");
+      break;
+    case ReportFormat::kTsv:
+      *this << "verdict\t" << word << (correct ? "\tcorrect" : "\tincorrect");
+      break;
+    case ReportFormat::kJsonLines:
+      *this << "{\"word\":";
+      JsonString(word);
+      *this << ",\"correct\":" << (correct ? "true}" : "false}");
+      break;
+    }
+    EndLine();
+  }
+
+  /**
+   * @brief writes one correction offered for word
+   *
+   * @param word
+   * @param correction
+   * @param type the case of misspelling, 'A', 'B' or 'C', or 0 for any
+   *        other edit
+   * @param distance edits between word and correction
+   */
+  void Correction(std::string_view word, std::string_view correction, char type, int distance)
+  {
+    switch (options_.format)
+    {
+    case ReportFormat::kText:
+      *this << "*** " << word << " -> " << correction << " *** ";
+      if (type != 0)
+        *this << "case " << type;
+      else
+        *this << "distance " << distance;
+      break;
+    case ReportFormat::kTsv:
+      *this << "correction\t" << word << '\t' << correction << '\t';
+      *this << (type != 0 ? type : '-') << '\t' << distance;
+      break;
+    case ReportFormat::kJsonLines:
+      *this << "{\"word\":";
+      JsonString(word);
+      *this << ",\"correction\":";
+      JsonString(correction);
+      *this << ",\"case\":";
+      if (type != 0)
+        *this << '"' << type << '"';
+      else
+        *this << "null";
+      *this << ",\"distance\":" << distance << '}';
+      break;
+    }
+    EndLine();
+  }
+
+  /**
+   * @brief writes the outcome of looking query up in a hash table
+   *
+   * @param query
+   * @param found
+   * @param probes
+   */
+  void Lookup(std::string_view query, bool found, int probes)
+  {
+    switch (options_.format)
+    {
+    case ReportFormat::kText:
+      *this << query << (found ? " Found " : ": Not_found ") << probes;
+      break;
+    case ReportFormat::kTsv:
+      *this << "lookup\t" << query << (found ? "\tfound\t" : "\tnot_found\t") << probes;
+      break;
+    case ReportFormat::kJsonLines:
+      *this << "{\"query\":";
+      JsonString(query);
+      *this << ",\"found\":" << (found ? "true" : "false") << ",\"probes\":" << probes << '}';
+      break;
+    }
+    EndLine();
+  }
+
+  /**
+   * @brief writes one named statistic
+   *
+   * @param name
+   * @param value
+   */
+  template <typename Number>
+  void Stat(std::string_view name, Number value)
+  {
+    switch (options_.format)
+    {
+    case ReportFormat::kText:
+      *this << name << ": " << value;
+      break;
+    case ReportFormat::kTsv:
+      *this << "stat\t" << name << '\t' << value;
+      break;
+    case ReportFormat::kJsonLines:
+      *this << "{\"stat\":";
+      JsonString(name);
+      *this << ",\"value\":";
+      if constexpr (std::is_floating_point<Number>::value)
+      {
+        if (!std::isfinite(value))
+        {
+          *this << "null}";
+          break;
+        }
+      }
+      *this << value << '}';
+      break;
+    }
+    EndLine();
+  }
+
+  /**
+   * @brief ends a group of records; in text a blank line, otherwise nothing
+   *
+   */
+  void EndSection()
+  {
+    if (options_.format == ReportFormat::kText)
+      EndLine();
+  }
+
+  ReportWriter &operator<<(std::string_view text)
+  {
+    buffer_.append(text);
+    return *this;
+  }
+
+  ReportWriter &operator<<(const char *text)
+  {
+    return *this << std::string_view(text);
+  }
+
+  ReportWriter &operator<<(char c)
+  {
+    buffer_ += c;
+    return *this;
+  }
+
+  /**
+   * @brief appends a number the way std::ostream would by default
+   *
+   * @param value
+   * @return ReportWriter&
+   */
+  template <typename Number,
+            typename = typename std::enable_if<std::is_arithmetic<Number>::value>::type>
+  ReportWriter &operator<<(Number value)
+  {
+    char digits[32];
+    if constexpr (std::is_floating_point<Number>::value)
+    {
+      int length = std::snprintf(digits, sizeof(digits), "%g", static_cast<double>(value));
+      buffer_.append(digits, length);
+    }
+    else
+    {
+      buffer_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+    }
+    return *this;
+  }
+
+  /**
+   * @brief ends the current line, and flushes if the line flush mode is on
+   *        or the buffer is full
+   *
+   */
+  void EndLine()
+  {
+    buffer_ += '\n';
+    if (options_.line_flush || buffer_.size() >= buffer_size_)
+      Flush();
+  }
+
+  /**
+   * @brief hands everything buffered to the stream and flushes it
+   *
+   */
+  void Flush()
+  {
+    out_.write(buffer_.data(), buffer_.size());
+    out_.flush();
+    buffer_.clear();
+  }
+
+private:
+  std::ostream &out_;
+  ReportOptions options_;
+  size_t buffer_size_;
+  std::string buffer_;
+
+  /**
+   * @brief appends text as a quoted JSON string
+   *
+   * @param text
+   */
+  void JsonString(std::string_view text)
+  {
+    buffer_ += '"';
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+      {
+        buffer_ += '\\';
+        buffer_ += c;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+        char escape[8];
+        std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(c));
+        buffer_ += escape;
+      }
+      else
+      {
+        buffer_ += c;
+      }
+    }
+    buffer_ += '"';
+  }
+};
+
+#endif // REPORT_WRITER_H
@@ -0,0 +1,511 @@
+/**
+ * @file robin_hood_hashing.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for HashTableRobinHood
+ *        (linear probing with Robin Hood displacement)
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Every slot remembers how far it sits from its home bucket. Inserting steals
+ * the slot of any resident that is closer to home than the incoming element,
+ * which keeps probe lengths tightly grouped around the mean and lets the table
+ * run at a much higher load factor than HashTableLinear.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef ROBIN_HOOD_HASHING_H
+#define ROBIN_HOOD_HASHING_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <exception>
+#include <iterator>
+#include <type_traits>
+
+#include "lookup_key.h"
+#include "prefetch.h"
+#include "growth_policy.h"
+#include "size_policy.h"
+#include "table_stats.h"
+
+template <typename HashedObj, typename SizePolicy = PrimeSizePolicy,
+          typename Hasher = std::hash<HashedObj>>
+class HashTableRobinHood
+{
+public:
+  enum EntryType
+  {
+    ACTIVE,
+    EMPTY
+  };
+
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
+  /**
+   * @brief Construct a new Hash Table Robin Hood object
+   *
+   * @param size
+   * @param max_load_factor fraction of slots that may be filled before a
+   *        rehash, clamped by GrowthPolicy::ValidLoadFactor
+   */
+  explicit HashTableRobinHood(size_t size = 101, double max_load_factor = 0.85)
+      : array_(size_policy_.Resize(size)),
+        max_load_factor_{GrowthPolicy::ValidLoadFactor(max_load_factor)}
+  {
+    MakeEmpty();
+  }
+
+  /**
+   * @brief Construct a new Hash Table Robin Hood object sized once for the
+   *        range [first, last) and filled from it
+   *
+   * @param first
+   * @param last
+   * @param max_load_factor fraction of slots that may be filled before a
+   *        rehash, clamped by GrowthPolicy::ValidLoadFactor
+   */
+  template <typename ForwardIt,
+            typename = typename std::enable_if<!std::is_integral<ForwardIt>::value>::type>
+  HashTableRobinHood(ForwardIt first, ForwardIt last, double max_load_factor = 0.85)
+      : array_(size_policy_.Resize(std::distance(first, last) /
+                                   GrowthPolicy::ValidLoadFactor(max_load_factor) + 1)),
+        max_load_factor_{GrowthPolicy::ValidLoadFactor(max_load_factor)}
+  {
+    MakeEmpty();
+    for (; first != last; ++first)
+      Insert(*first);
+  }
+
+  /**
+   * @brief returns if x is in this HashTable object
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  template <typename Key>
+  bool Contains(const Key &x) const
+  {
+    return Find(x).found;
+  }
+
+  /**
+   * @brief deletes all entries in this HashTable
+   *
+   */
+  void MakeEmpty()
+  {
+    current_size_ = 0;
+    for (auto &entry : array_)
+    {
+      entry.info_ = EMPTY;
+      entry.distance_ = 0;
+    }
+  }
+
+  /**
+   * @brief size the table once so that n elements fit without any further
+   *        rehashing
+   *
+   * @param n
+   */
+  void Reserve(size_t n)
+  {
+    size_t needed = n / max_load_factor_ + 1;
+    if (needed > array_.size())
+      Rehash(needed);
+  }
+
+  /**
+   * @brief grow the table to at least slots slots (rounded up the way the
+   *        table sizes itself) and rehash every element into it. Reserve
+   *        takes an element count instead.
+   *
+   * @param slots
+   */
+  void ReserveSlots(size_t slots)
+  {
+    if (slots > array_.size())
+      Rehash(slots);
+  }
+
+  /**
+   * @brief return how many probes it took to find in, otherwise throw an exception
+   *
+   * @param in
+   * @return int
+   */
+  int Get(const HashedObj &in)
+  {
+    if (FindPos(in) == array_.size())
+    {
+      stats_.miss_probes.Add(temp_collisions_);
+      throw KeyError();
+    }
+    stats_.hit_probes.Add(temp_collisions_);
+    return temp_collisions_;
+  }
+
+  /**
+   * @brief look up in without throwing; reports the probes taken whether or
+   *        not it was found. Find writes nothing, so any number of threads
+   *        may call it at once while no thread modifies the table; its probes
+   *        are not added to TotalCollisions. in may be any key type that
+   *        lookup_key.h can hash, e.g. a std::string_view into a string table.
+   *
+   * @param in
+   * @return LookupResult
+   */
+  template <typename Key>
+  LookupResult Find(const Key &in) const
+  {
+    int probes;
+    bool found = FindPos(in, Hash(in), probes) != array_.size();
+    return LookupResult{found, probes};
+  }
+
+  /**
+   * @brief Find every key in [first, last), writing one LookupResult per key
+   *        to results. Each batch of keys is hashed and has its home slots
+   *        prefetched before any of them is probed, so their cache misses
+   *        overlap instead of being paid one at a time.
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    size_t hashes[kPrefetchBatch];
+    while (first != last)
+    {
+      ForwardIt batch = first;
+      size_t count = 0;
+      for (; first != last && count < kPrefetchBatch; ++first, ++count)
+      {
+        const auto &key = *first;
+        hashes[count] = Hash(key);
+        Prefetch(&array_[size_policy_.Index(hashes[count])]);
+      }
+      for (size_t x = 0; x < count; ++x, ++batch)
+      {
+        int probes;
+        bool found = FindPos(*batch, hashes[x], probes) != array_.size();
+        *results++ = LookupResult{found, probes};
+      }
+    }
+    return results;
+  }
+
+  /**
+   * @brief insert new element into HashTable
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Insert(const HashedObj &x)
+  {
+    this->total_elements_++;
+    size_t hash = Hash(x);
+    size_t current_pos = FindPos(x, hash);
+    stats_.insert_probes.Add(temp_collisions_);
+    if (current_pos != array_.size())
+      return false;
+
+    HashEntry entry{x, ACTIVE};
+    entry.hash_ = hash;
+    Place(std::move(entry));
+
+    if (++current_size_ > array_.size() * max_load_factor_)
+    {
+      Rehash();
+    }
+    return true;
+  }
+
+  /**
+   * @brief find and remove element x, shifting the rest of its cluster back
+   *        so no tombstone is left behind
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Remove(const HashedObj &x)
+  {
+    size_t current_pos = FindPos(x);
+    if (current_pos == array_.size())
+      return false;
+
+    size_t next_pos = Next(current_pos);
+    while (array_[next_pos].info_ == ACTIVE && array_[next_pos].distance_ > 0)
+    {
+      array_[current_pos] = std::move(array_[next_pos]);
+      array_[current_pos].distance_--;
+      current_pos = next_pos;
+      next_pos = Next(next_pos);
+    }
+    array_[current_pos].info_ = EMPTY;
+    array_[current_pos].distance_ = 0;
+    current_size_--;
+    return true;
+  }
+
+  /**
+   * @brief return total collisions that occured while probing
+   *
+   * @return int
+   */
+  int TotalCollisions()
+  {
+    return collisions_;
+  }
+
+  /**
+   * @brief returns total elements in HashTable
+   *
+   * @return int
+   */
+  int TotalElements()
+  {
+    return this->total_elements_;
+  }
+
+  /**
+   * @brief returns internal HashTable allocated size
+   *
+   * @return int
+   */
+  int InternalSize()
+  {
+    return this->array_.size();
+  }
+
+  /**
+   * @brief returns the longest distance any element sits from its home bucket
+   *
+   * @return int
+   */
+  int MaxProbeDistance()
+  {
+    size_t longest = 0;
+    for (auto &entry : array_)
+      if (entry.info_ == ACTIVE)
+        longest = std::max(longest, entry.distance_);
+    return longest;
+  }
+
+  /**
+   * @brief returns the table's health statistics; see table_stats.h. Remove
+   *        shifts entries back instead of leaving tombstones, so there are
+   *        none.
+   *
+   * @return TableStats
+   */
+  TableStats Stats() const
+  {
+    TableStats stats = stats_;
+    stats.elements = current_size_;
+    stats.slots = array_.size();
+    stats.bytes_used = array_.capacity() * sizeof(HashEntry);
+    stats.cluster_sizes = ClusterSizes(array_.size(), [this](size_t pos)
+                                       { return array_[pos].info_ == ACTIVE; });
+    return stats;
+  }
+  int temp_collisions_ = 0;
+
+private:
+  /**
+   * @brief metadata associates with the object being hashed, along with its
+   *        distance from its home bucket and its cached full hash
+   *
+   */
+  struct HashEntry
+  {
+    HashedObj element_;
+    EntryType info_;
+    size_t distance_;
+    size_t hash_;
+
+    HashEntry(const HashedObj &e = HashedObj{}, EntryType i = EMPTY)
+        : element_{e}, info_{i}, distance_{0}, hash_{0} {}
+
+    HashEntry(HashedObj &&e, EntryType i = EMPTY)
+        : element_{std::move(e)}, info_{i}, distance_{0}, hash_{0} {}
+  };
+
+  /**
+   * @brief error object if a key is not found
+   *
+   */
+  struct KeyError : public std::exception
+  {
+    const char *what() const throw()
+    {
+      return "Key Not Found";
+    }
+  };
+
+  // Declared ahead of the array so constructors can size it through it.
+  SizePolicy size_policy_;
+  std::vector<HashEntry> array_;
+  double max_load_factor_;
+  size_t current_size_;
+  size_t total_elements_ = 0;
+  size_t collisions_ = 0;
+  // Recorded parts of Stats().
+  TableStats stats_;
+
+  /**
+   * @brief returns the slot following current_pos, wrapping around
+   *
+   * @param current_pos
+   * @return size_t
+   */
+  size_t Next(size_t current_pos) const
+  {
+    return (current_pos + 1 == array_.size()) ? 0 : current_pos + 1;
+  }
+
+  /**
+   * @brief returns the position of the object x in the HashMap, or
+   *        array_.size() if it is absent. The search stops as soon as it
+   *        reaches a slot whose resident is closer to home than x would be,
+   *        since Robin Hood insertion would have placed x before it.
+   *
+   * @param x
+   * @return size_t
+   */
+  size_t FindPos(const HashedObj &x)
+  {
+    return FindPos(x, Hash(x));
+  }
+
+  /**
+   * @brief FindPos for a caller that already has hash == Hash(x)
+   *
+   * @param x
+   * @param hash
+   * @return size_t
+   */
+  size_t FindPos(const HashedObj &x, size_t hash)
+  {
+    int probes;
+    size_t current_pos = FindPos(x, hash, probes);
+    temp_collisions_ = probes;
+    collisions_ += (probes - 1);
+    return current_pos;
+  }
+
+  /**
+   * @brief the probing loop behind FindPos. It only reads the table and
+   *        reports the slots it examined through probes.
+   *
+   * @param x
+   * @param hash
+   * @param probes set to the number of slots examined
+   * @return size_t
+   */
+  template <typename Key>
+  size_t FindPos(const Key &x, size_t hash, int &probes) const
+  {
+    size_t current_pos = size_policy_.Index(hash);
+    size_t distance = 0;
+    probes = 1;
+    while (array_[current_pos].info_ == ACTIVE &&
+           array_[current_pos].distance_ >= distance)
+    {
+      if (array_[current_pos].hash_ == hash && array_[current_pos].element_ == x)
+        return current_pos;
+      probes++;
+      distance++;
+      current_pos = Next(current_pos);
+    }
+    return array_.size();
+  }
+
+  /**
+   * @brief places an entry known to be absent, displacing richer residents
+   *
+   * @param carry
+   */
+  void Place(HashEntry &&carry)
+  {
+    size_t current_pos = size_policy_.Index(carry.hash_);
+    carry.distance_ = 0;
+    while (array_[current_pos].info_ == ACTIVE)
+    {
+      if (array_[current_pos].distance_ < carry.distance_)
+        std::swap(carry, array_[current_pos]);
+      carry.distance_++;
+      current_pos = Next(current_pos);
+    }
+    array_[current_pos] = std::move(carry);
+  }
+
+  /**
+   * @brief when the internal vector reaches load capacity, resize the vector and
+   *        reinsert all elements
+   *
+   */
+  void Rehash()
+  {
+    Rehash(2 * array_.size());
+  }
+
+  /**
+   * @brief resize the internal vector to at least min_size slots and reinsert
+   *        all elements
+   *
+   * @param min_size
+   */
+  void Rehash(size_t min_size)
+  {
+    RehashTimer timer(stats_);
+    std::vector<HashEntry> old_array = std::move(array_);
+
+    // Create new empty table.
+    array_ = std::vector<HashEntry>(size_policy_.Resize(min_size));
+
+    // Copy table over.
+    for (auto &entry : old_array)
+      if (entry.info_ == ACTIVE)
+        Place(std::move(entry));
+  }
+
+  /**
+   * @brief returns the hash of x, which is a HashedObj or a lookup key
+   *        equal to one
+   *
+   * @param x
+   * @return size_t
+   */
+  template <typename Key>
+  static size_t Hash(const Key &x)
+  {
+    static Hasher hf;
+    return HashLookupKey(hf, x);
+  }
+};
+
+#endif // ROBIN_HOOD_HASHING_H
@@ -0,0 +1,218 @@
+/**
+ * @file size_policy.h
+ * @author Moududur Rahman
+ * @brief Table-size policies shared by the open addressing hash tables
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * A size policy decides which capacities a table may have and maps a hash
+ * code to a slot in [0, capacity). Tables keep one policy object per array
+ * and ask it for every home slot, so the mapping is the only place that
+ * depends on how the capacity was chosen.
+ *
+ * PrimeSizePolicy (the default) walks a precomputed ladder of primes, falling
+ * back to the next prime for sizes no rung is close to, and replaces the
+ * hardware division with a precomputed fast-modulo multiply.
+ * PowerOfTwoSizePolicy masks instead, after Fibonacci (multiplicative)
+ * mixing so that weak low bits in the hash still spread across the table.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef SIZE_POLICY_H
+#define SIZE_POLICY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+class PrimeSizePolicy
+{
+public:
+  static const bool kPowerOfTwo = false;
+
+  /**
+   * @brief selects a prime capacity of at least n and precomputes its
+   *        fast-modulo constant. The next rung of the ladder is used when it
+   *        is within an eighth of n, which covers doubling; other sizes, such
+   *        as those of a smaller growth factor, get NextPrime(n).
+   *
+   * @param n
+   * @return size_t the new capacity
+   */
+  size_t Resize(size_t n)
+  {
+    const size_t *end = Ladder() + kLadderSize;
+    const size_t *found = std::lower_bound(Ladder(), end, n);
+    capacity_ = (found != end && *found - n <= n / 8) ? *found : NextPrime(n);
+#ifdef __SIZEOF_INT128__
+    magic_ = ~static_cast<unsigned __int128>(0) / capacity_ + 1;
+#endif
+    return capacity_;
+  }
+
+  /**
+   * @brief returns the current capacity
+   *
+   * @return size_t
+   */
+  size_t Capacity() const
+  {
+    return capacity_;
+  }
+
+  /**
+   * @brief returns hash % capacity
+   *
+   * @param hash
+   * @return size_t
+   */
+  size_t Index(size_t hash) const
+  {
+#ifdef __SIZEOF_INT128__
+    // Lemire's fastmod: the low 128 bits of magic * hash, times the capacity,
+    // carry the remainder in bits 128..191.
+    unsigned __int128 low_bits = magic_ * hash;
+    unsigned __int128 bottom = ((low_bits & UINT64_MAX) * capacity_) >> 64;
+    unsigned __int128 top = (low_bits >> 64) * capacity_;
+    return static_cast<size_t>((bottom + top) >> 64);
+#else
+    return hash % capacity_;
+#endif
+  }
+
+  /**
+   * @brief returns a double hashing step that visits every slot. Any nonzero
+   *        step below a prime capacity does.
+   *
+   * @param step
+   * @return size_t
+   */
+  size_t Step(size_t step) const
+  {
+    step = Index(step);
+    return step == 0 ? 1 : step;
+  }
+
+private:
+  static const size_t kLadderSize = 33;
+
+  size_t capacity_ = 0;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 magic_ = 0;
+#endif
+
+  /**
+   * @brief returns the precomputed capacities. Each entry from 101 up is
+   *        NextPrime(2 * previous), so default-sized tables grow through
+   *        exactly the capacities they always have.
+   *
+   * @return const size_t*
+   */
+  static const size_t *Ladder()
+  {
+    static const size_t ladder[kLadderSize] = {
+        3, 7, 13, 29, 53,
+        101, 211, 431, 863, 1733, 3467, 6947, 13901, 27803, 55609, 111227,
+        222461, 444929, 889871, 1779761, 3559537, 7119103, 14238221, 28476473,
+        56952947, 113905901, 227811809, 455623621, 911247257, 1822494581,
+        3644989199, 7289978407, 14579956817};
+    return ladder;
+  }
+
+  /**
+   * @brief returns if n is prime; only used for sizes off the ladder
+   *
+   * @param n
+   * @return true
+   * @return false
+   */
+  static bool IsPrime(size_t n)
+  {
+    if (n == 2 || n == 3)
+      return true;
+
+    if (n == 1 || n % 2 == 0)
+      return false;
+
+    for (size_t i = 3; i * i <= n; i += 2)
+      if (n % i == 0)
+        return false;
+
+    return true;
+  }
+
+  // Internal method to return a prime number at least as large as n.
+  static size_t NextPrime(size_t n)
+  {
+    if (n % 2 == 0)
+      ++n;
+    while (!IsPrime(n))
+      n += 2;
+    return n;
+  }
+};
+
+class PowerOfTwoSizePolicy
+{
+public:
+  static const bool kPowerOfTwo = true;
+
+  /**
+   * @brief selects the smallest power of two that is at least n
+   *
+   * @param n
+   * @return size_t the new capacity
+   */
+  size_t Resize(size_t n)
+  {
+    capacity_ = 8;
+    shift_ = 61;
+    while (capacity_ < n)
+    {
+      capacity_ *= 2;
+      shift_--;
+    }
+    return capacity_;
+  }
+
+  /**
+   * @brief returns the current capacity
+   *
+   * @return size_t
+   */
+  size_t Capacity() const
+  {
+    return capacity_;
+  }
+
+  /**
+   * @brief maps hash to a slot by keeping the top bits of hash * 2^64/phi
+   *
+   * @param hash
+   * @return size_t
+   */
+  size_t Index(size_t hash) const
+  {
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * UINT64_C(11400714819323198485)) >> shift_);
+  }
+
+  /**
+   * @brief returns a double hashing step that visits every slot. Only odd
+   *        steps are coprime with a power-of-two capacity.
+   *
+   * @param step
+   * @return size_t
+   */
+  size_t Step(size_t step) const
+  {
+    return (step & (capacity_ - 1)) | 1;
+  }
+
+private:
+  size_t capacity_ = 0;
+  unsigned shift_ = 64;
+};
+
+#endif // SIZE_POLICY_H
@@ -9,25 +9,51 @@
  * @copyright Copyright (c) 2021
  * 
  */
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <locale>
+#include <string_view>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 // You can change to quadratic probing if you
 // haven't implemented double hashing.
 #include "double_hashing.h"
+#include "cuckoo_hashing.h"
+#include "mapped_dictionary.h"
+#include "table_image.h"
+#include "string_arena.h"
+#include "suggestion_index.h"
+#include "bk_tree.h"
+#include "document_tokenizer.h"
+#include "report_writer.h"
 using namespace std;
 
 // You can add more functions here.
 
+// Returns the number of lines in file, used to size the dictionary up front.
+size_t CountLines(const string &file)
+{
+  ifstream in(file, ios::binary);
+  return count(istreambuf_iterator<char>(in), istreambuf_iterator<char>(), '\n') + 1;
+}
+
 // Creates and fills double hashing hash table with all words from
-// dictionary_file
+// dictionary_file. The file is read twice: once to count its lines so the
+// table is sized in a single step, then again to insert the words.
 HashTableDouble<string> MakeDictionary(const string &dictionary_file)
 {
   string line;
   fstream d_file(dictionary_file);
   HashTableDouble<string> dictionary_hash(73, 101);
+  dictionary_hash.Reserve(CountLines(dictionary_file));
 
   while (d_file >> line)
   {
@@ -38,84 +64,388 @@ HashTableDouble<string> MakeDictionary(const string &dictionary_file)
   return dictionary_hash;
 }
 
-struct AltSpelling
+// Fills dictionary, an empty ArenaStringTable or HashTableCuckoo, with all
+// words from dictionary_file, sized up front like MakeDictionary.
+template <typename Table>
+void FillDictionary(Table &dictionary, const string &dictionary_file)
 {
-  std::string spelling;
-  char type;
+  string line;
+  fstream d_file(dictionary_file);
+  dictionary.Reserve(CountLines(dictionary_file));
+
+  while (d_file >> line)
+  {
+    dictionary.Insert(line);
+  }
+}
+
+// The alternate spellings of one word, back to back in a single buffer.
+// spellings[x] views the x-th of them and types[x] is its case. Reused
+// between words, so once buffer has grown to fit the longest word seen,
+// generating candidates allocates nothing.
+struct AltSpellings
+{
+  std::string buffer;
+  std::vector<std::string_view> spellings;
+  std::vector<char> types;
 };
 
-// For each word in the document_file, it checks the 3 cases for a word being
-// misspelled and prints out possible corrections
-void SpellChecker(HashTableDouble<string> &dictionary,
-                  const string &document_file)
+// What CheckWord found: whether the word itself is in the dictionary, and
+// otherwise how many corrections it wrote.
+struct WordCheck
+{
+  bool found;
+  int corrections;
+};
+
+// Checks one word of the document, as DocumentTokenizer returns it, against
+// dictionary and, if it is misspelled, tries the 3 cases of misspelling,
+// writing the verdict and any corrections to out. alternate_spellings is
+// scratch space reused between calls.
+template <typename Dictionary>
+WordCheck CheckWord(const Dictionary &dictionary, std::string_view line,
+                    AltSpellings &alternate_spellings, ReportWriter &out)
 {
-  std::string alphabet = "abcdefghijklmnopqrstuvwxyz";
-  std::string line;
-  std::fstream doc_file(document_file);
-  std::locale loc;
-  std::vector<AltSpelling> alternate_spellings;
-  while (doc_file >> line)
+  static const std::string alphabet = "abcdefghijklmnopqrstuvwxyz";
+  int corrections = 0;
+
+  bool in_dictionary = static_cast<bool>(dictionary.Find(line));
+  if (in_dictionary)
   {
-    for (size_t x = 0; x < line.size(); x++)
+    out.Verdict(line, true);
+  }
+  else
+  {
+    out.Verdict(line, false);
+    std::string &buffer = alternate_spellings.buffer;
+    std::vector<char> &types = alternate_spellings.types;
+    std::vector<std::string_view> &spellings = alternate_spellings.spellings;
+    buffer.clear();
+    types.clear();
+    spellings.clear();
+
+    // generate all of the possible misspellings straight into buffer
+    for (size_t x = 0; x < 26; x++)
     {
-      line.replace(x, 1, std::string(1, std::tolower(line[x], loc)));
-      if (line[x] == '.' || line[x] == ',')
+      for (size_t y = 0; y < line.size() + 1; y++)
       {
-        line.erase(x, x + 1);
+        buffer.append(line, 0, y);
+        buffer += alphabet[x];
+        buffer.append(line, y, std::string::npos);
+        types.push_back('A');
       }
     }
 
-    try
+    for (size_t x = 0; x < line.size(); x++)
     {
-      dictionary.Get(line);
-      std::cout << line << " is CORRECT" << std::endl;
+      buffer.append(line, 0, x);
+      buffer.append(line, x + 1, std::string::npos);
+      types.push_back('B');
     }
-    catch (const std::exception &e)
+
+    for (size_t x = 0; x + 1 < line.size(); x++)
     {
-      std::cout << line << " is INCORRECT" << std::endl;
-      string copy = line;
+      size_t start = buffer.size();
+      buffer += line;
+      std::swap(buffer[start + x], buffer[start + x + 1]);
+      types.push_back('C');
+    }
 
-      // generate all of the possible misspellings  
-      for (size_t x = 0; x < 26; x++)
-      {
-        for (size_t y = 0; y < line.size() + 1; y++)
-        {
-          copy.insert(y, std::string(1, alphabet[x]));
-          alternate_spellings.push_back(AltSpelling{copy, 'A'});
-          copy = line;
-        }
-      }
+    // buffer is complete, so views into it stay valid from here on; each
+    // case fixes its spellings' length
+    size_t offset = 0;
+    for (char type : types)
+    {
+      size_t length = type == 'A' ? line.size() + 1 : type == 'B' ? line.size() - 1 : line.size();
+      spellings.emplace_back(buffer.data() + offset, length);
+      offset += length;
+    }
 
-      for (size_t x = 0; x < line.size(); x++)
+    // try all alternate spellings, as one batch so that the dictionary can
+    // overlap their cache misses
+    static thread_local std::vector<decltype(dictionary.Find(line))> found;
+    found.resize(spellings.size());
+    dictionary.FindBatch(spellings.begin(), spellings.end(), found.begin());
+    for (size_t x = 0; x < spellings.size(); x++)
+    {
+      if (found[x])
       {
-        copy.erase(x, 1);
-        alternate_spellings.push_back(AltSpelling{copy, 'B'});
-        copy = line;
+        out.Correction(line, spellings[x], types[x], 1);
+        corrections++;
       }
+    }
+  }
+  return WordCheck{in_dictionary, corrections};
+}
 
-      for (size_t x = 0; x < line.size() - 1; x++)
-      {
-        std::swap(copy[x], copy[x + 1]);
-        alternate_spellings.push_back(AltSpelling{copy, 'C'});
-        copy = line;
-      }
+// For each word in the document_file, it checks the 3 cases for a word being
+// misspelled and prints out possible corrections. Dictionary is anything with
+// a non-throwing Find and FindBatch, e.g. HashTableDouble<string>,
+// HashTableCuckoo<string> or MappedDictionary.
+template <typename Dictionary>
+void SpellChecker(const Dictionary &dictionary,
+                  const string &document_file)
+{
+  std::string_view line;
+  DocumentTokenizer document(document_file);
+  AltSpellings alternate_spellings;
+  ReportWriter out(std::cout, ReportOptions::FromEnvironment());
+  while (document.Next(line))
+  {
+    CheckWord(dictionary, line, alternate_spellings, out);
+  }
+}
 
-      // try all alternate spellings
-      for (auto x : alternate_spellings)
+// Like CheckWord, but the corrections come from suggester (anything with
+// Suggest(word, max_distance), e.g. SuggestionIndex) instead of probing the
+// dictionary for every candidate. Prints the closest words found within 2
+// edits: those 1 edit away are labelled with their case when they are one of
+// the 3 cases of misspelling, and with their distance otherwise.
+template <typename Dictionary, typename Suggester>
+void CheckWordWithSuggestions(const Dictionary &dictionary, const Suggester &suggester,
+                              std::string_view line, ReportWriter &out)
+{
+  if (dictionary.Find(line))
+  {
+    out.Verdict(line, true);
+    return;
+  }
+
+  out.Verdict(line, false);
+  std::vector<Suggestion> suggestions = suggester.Suggest(line, 2);
+  for (const Suggestion &suggestion : suggestions)
+  {
+    if (suggestion.distance > suggestions.front().distance)
+    {
+      break;
+    }
+    out.Correction(line, suggestion.word, suggestion.type, suggestion.distance);
+  }
+}
+
+// SpellChecker with corrections taken from suggester; see
+// CheckWordWithSuggestions.
+template <typename Dictionary, typename Suggester>
+void SuggestingSpellChecker(const Dictionary &dictionary, const Suggester &suggester,
+                            const string &document_file)
+{
+  std::string_view line;
+  DocumentTokenizer document(document_file);
+  ReportWriter out(std::cout, ReportOptions::FromEnvironment());
+  while (document.Next(line))
+  {
+    CheckWordWithSuggestions(dictionary, suggester, line, out);
+  }
+}
+
+// SpellChecker that falls back on tree for misspellings none of the 3 cases
+// can fix: it prints the fallback_count closest words within a third of the
+// word's length in edits (at least 2), which reaches long or badly mangled
+// words the candidate enumeration never will.
+template <typename Dictionary>
+void FallbackSpellChecker(const Dictionary &dictionary, const BKTree &tree,
+                          const string &document_file, size_t fallback_count = 3)
+{
+  std::string_view line;
+  DocumentTokenizer document(document_file);
+  AltSpellings alternate_spellings;
+  ReportWriter out(std::cout, ReportOptions::FromEnvironment());
+  while (document.Next(line))
+  {
+    WordCheck check = CheckWord(dictionary, line, alternate_spellings, out);
+    if (check.found || check.corrections != 0)
+    {
+      continue;
+    }
+    int max_distance = std::max<int>(2, line.size() / 3);
+    for (const Suggestion &suggestion : tree.Closest(line, fallback_count, max_distance))
+    {
+      out.Correction(line, suggestion.word, 0, suggestion.distance);
+    }
+  }
+}
+
+// Times the correction engines on every misspelled word of document_file
+// and prints one tab separated row per engine: the time to build it, the
+// average time per misspelled word, and the average number of corrections
+// offered. "enumeration" is the 3-case candidate search of CheckWord.
+void CompareCorrectionEngines(const HashTableDouble<string> &dictionary,
+                              const string &dictionary_file, const string &document_file)
+{
+  std::vector<std::string> misspelled;
+  std::string_view line;
+  DocumentTokenizer document(document_file);
+  while (document.Next(line))
+  {
+    if (!dictionary.Find(line))
+    {
+      misspelled.emplace_back(line);
+    }
+  }
+  ifstream d_file(dictionary_file);
+  std::vector<std::string> words{istream_iterator<string>(d_file), istream_iterator<string>()};
+
+  auto milliseconds_since = [](chrono::steady_clock::time_point start)
+  {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+  };
+  auto print_row = [&](const string &engine, double build_ms, double query_ms, size_t found)
+  {
+    std::cout << engine << "\t" << build_ms
+              << "\t" << query_ms * 1000 / misspelled.size()
+              << "\t" << found / (double)misspelled.size() << std::endl;
+  };
+  std::cout << "engine\tbuild_ms\tquery_us_per_word\tcorrections_per_word" << std::endl;
+  if (misspelled.empty())
+  {
+    return;
+  }
+
+  AltSpellings alternate_spellings;
+  std::ostringstream discarded;
+  ReportWriter discard(discarded);
+  size_t found = 0;
+  auto start = chrono::steady_clock::now();
+  for (const std::string &word : misspelled)
+  {
+    found += CheckWord(dictionary, word, alternate_spellings, discard).corrections;
+  }
+  print_row("enumeration", 0, milliseconds_since(start), found);
+
+  start = chrono::steady_clock::now();
+  SuggestionIndex index(words.begin(), words.end());
+  double build_ms = milliseconds_since(start);
+  found = 0;
+  start = chrono::steady_clock::now();
+  for (const std::string &word : misspelled)
+  {
+    found += index.Suggest(word, 2).size();
+  }
+  print_row("symmetric_delete_d2", build_ms, milliseconds_since(start), found);
+
+  start = chrono::steady_clock::now();
+  BKTree tree(words.begin(), words.end());
+  build_ms = milliseconds_since(start);
+  found = 0;
+  start = chrono::steady_clock::now();
+  for (const std::string &word : misspelled)
+  {
+    found += tree.Suggest(word, 2).size();
+  }
+  print_row("bktree_d2", build_ms, milliseconds_since(start), found);
+
+  found = 0;
+  start = chrono::steady_clock::now();
+  for (const std::string &word : misspelled)
+  {
+    found += tree.Closest(word, 3, std::max<int>(2, word.size() / 3)).size();
+  }
+  print_row("bktree_closest3", build_ms, milliseconds_since(start), found);
+}
+
+// Same output as SpellChecker, but the document's words are split into
+// chunks that thread_count threads check concurrently; each chunk's output
+// is buffered and printed in document order once all chunks are done.
+// Every thread shares dictionary through its const Find, which the tables
+// keep free of writes.
+template <typename Dictionary>
+void ParallelSpellChecker(const Dictionary &dictionary, const string &document_file,
+                          size_t thread_count)
+{
+  std::vector<std::string> words;
+  std::string_view line;
+  DocumentTokenizer document(document_file);
+  while (document.Next(line))
+  {
+    words.emplace_back(line);
+  }
+
+  // Several chunks per thread so a thread that draws typo-heavy chunks
+  // doesn't leave the others idle.
+  const size_t words_per_chunk = 64;
+  const size_t chunk_count = (words.size() + words_per_chunk - 1) / words_per_chunk;
+  std::vector<std::ostringstream> chunk_output(chunk_count);
+  std::atomic<size_t> next_chunk(0);
+  const ReportOptions options = ReportOptions::FromEnvironment();
+
+  auto worker = [&]()
+  {
+    AltSpellings alternate_spellings;
+    for (size_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++)
+    {
+      ReportWriter out(chunk_output[chunk], options);
+      size_t end = std::min(words.size(), (chunk + 1) * words_per_chunk);
+      for (size_t x = chunk * words_per_chunk; x < end; x++)
       {
-        try
-        {
-          dictionary.Get(x.spelling);
-          std::cout << "*** " << line << " -> " << x.spelling << " *** case " << x.type << std::endl;
-        }
-        catch (const std::exception &e)
-        {
-        }
+        CheckWord(dictionary, words[x], alternate_spellings, out);
       }
-
-      alternate_spellings.clear();
     }
+  };
+
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < thread_count; t++)
+  {
+    pool.emplace_back(worker);
+  }
+  for (auto &thread : pool)
+  {
+    thread.join();
+  }
+
+  for (auto &output : chunk_output)
+  {
+    std::cout << output.str();
   }
+  std::cout.flush();
+}
+
+// Opens the table image built from dictionary_filename, building or
+// rebuilding it first if it is missing, malformed or older than the
+// dictionary. An image that is reused is not checksummed, so that opening
+// it only faults in the pages the lookups touch; a rebuilt one is verified
+// as it is read back. Returns false if no usable image could be opened.
+bool OpenDictionaryImage(TableImage &dictionary, const string &dictionary_filename)
+{
+  const string image_filename = dictionary_filename + ".img";
+  if (!dictionary.Open(image_filename) || !dictionary.MatchesSource(dictionary_filename))
+  {
+    TableImage::Build(dictionary_filename, image_filename);
+    if (dictionary.Open(image_filename) && !dictionary.Verify())
+      dictionary.Close();
+  }
+  if (!dictionary.IsOpen())
+  {
+    cout << "Could not build " << image_filename << endl;
+    return false;
+  }
+  return true;
+}
+
+// Parses text, all of it, as a positive integer into value. Returns false
+// and leaves value alone for anything else: no digits, trailing characters,
+// zero, negatives or out of range.
+bool ParsePositive(const char *text, int &value)
+{
+  const char *end = text + strlen(text);
+  int parsed = 0;
+  auto result = from_chars(text, end, parsed);
+  if (result.ec != errc() || result.ptr != end || parsed <= 0)
+    return false;
+  value = parsed;
+  return true;
+}
+
+// Prints how to run program.
+void PrintUsage(const char *program)
+{
+  cout << "Usage: " << program << " <document-file> <dictionary-file>"
+       << endl;
+  cout << "or Usage: " << program
+       << " <document-file> <dictionary-file> <mmap|image|arena|cuckoo|suggest|bktree|timings>" << endl;
+  cout << "or Usage: " << program
+       << " <document-file> <dictionary-file> parallel [threads]" << endl;
+  cout << "Set REPORT_FORMAT=tsv or jsonl for machine-readable output, and"
+       << " REPORT_FLUSH=line to flush after every line." << endl;
 }
 
 // @argument_count: same as argc in main
@@ -125,6 +455,113 @@ int testSpellingWrapper(int argument_count, char **argument_list)
 {
   const string document_filename(argument_list[1]);
   const string dictionary_filename(argument_list[2]);
+  const string mode = argument_count >= 4 ? argument_list[3] : "";
+
+  for (const string &filename : {document_filename, dictionary_filename})
+  {
+    if (!ifstream(filename))
+    {
+      cout << "Could not open " << filename << endl;
+      return 1;
+    }
+  }
+
+  if (mode == "mmap")
+  {
+    // Words stay in the mapped file; the table only holds views into it.
+    MappedDictionary dictionary(dictionary_filename);
+    if (!dictionary.IsOpen())
+    {
+      cout << "Could not map " << dictionary_filename << endl;
+      return 1;
+    }
+    SpellChecker(dictionary, document_filename);
+    return 0;
+  }
+
+  if (mode == "arena")
+  {
+    // The words are copied into the table's arena rather than into one
+    // std::string each.
+    ArenaStringTable<> dictionary(73, 101);
+    FillDictionary(dictionary, dictionary_filename);
+    SpellChecker(dictionary, document_filename);
+    return 0;
+  }
+
+  if (mode == "cuckoo")
+  {
+    // Every lookup examines at most two buckets.
+    HashTableCuckoo<string> dictionary;
+    FillDictionary(dictionary, dictionary_filename);
+    SpellChecker(dictionary, document_filename);
+    return 0;
+  }
+
+  if (mode == "image")
+  {
+    // Reuse the prebuilt table next to the dictionary.
+    TableImage dictionary;
+    if (!OpenDictionaryImage(dictionary, dictionary_filename))
+      return 1;
+    SpellChecker(dictionary, document_filename);
+    return 0;
+  }
+
+  if (mode == "suggest")
+  {
+    // Index the dictionary's delete variants once; each misspelling then
+    // costs a few dozen index lookups and also finds 2-edit corrections.
+    HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
+    ifstream d_file(dictionary_filename);
+    SuggestionIndex index{istream_iterator<string>(d_file), istream_iterator<string>()};
+    SuggestingSpellChecker(dictionary, index, document_filename);
+    return 0;
+  }
+
+  if (mode == "bktree")
+  {
+    // The usual 3 cases, then the BK-tree for words they can't correct.
+    HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
+    ifstream d_file(dictionary_filename);
+    BKTree tree{istream_iterator<string>(d_file), istream_iterator<string>()};
+    FallbackSpellChecker(dictionary, tree, document_filename);
+    return 0;
+  }
+
+  if (mode == "timings")
+  {
+    HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
+    CompareCorrectionEngines(dictionary, dictionary_filename, document_filename);
+    return 0;
+  }
+
+  if (mode == "parallel")
+  {
+    // Built once, then only read, so all threads can share it.
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    if (argument_count == 5)
+    {
+      int threads;
+      if (!ParsePositive(argument_list[4], threads))
+      {
+        cout << "Invalid thread count " << argument_list[4] << endl;
+        PrintUsage(argument_list[0]);
+        return 1;
+      }
+      thread_count = threads;
+    }
+    const HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
+    ParallelSpellChecker(dictionary, document_filename, thread_count);
+    return 0;
+  }
+
+  if (!mode.empty())
+  {
+    cout << "Unknown mode " << mode << endl;
+    PrintUsage(argument_list[0]);
+    return 1;
+  }
 
   // Call functions implementing the assignment requirements.
   HashTableDouble<string> dictionary = MakeDictionary(dictionary_filename);
@@ -139,14 +576,11 @@ int testSpellingWrapper(int argument_count, char **argument_list)
 // THERE. This main is only here for your own testing purposes.
 int main(int argc, char **argv)
 {
-  if (argc != 3)
+  if (argc < 3 or argc > 5)
   {
-    cout << "Usage: " << argv[0] << " <document-file> <dictionary-file>"
-         << endl;
+    PrintUsage(argv[0]);
     return 0;
   }
 
-  testSpellingWrapper(argc, argv);
-
-  return 0;
+  return testSpellingWrapper(argc, argv);
 }
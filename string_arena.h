@@ -0,0 +1,294 @@
+/**
+ * @file string_arena.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for StringArena
+ *        and ArenaStringTable (hash table keys stored in a shared arena)
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * A HashTable<std::string> gives every key its own heap allocation and keeps
+ * a default-constructed std::string in every empty slot. ArenaStringTable
+ * instead copies keys back to back into large arena blocks and keys the
+ * table by std::string_view handles into them: one allocation per block
+ * rather than per word, smaller slots (a slot also caches the hash and the
+ * state, so with 64-bit libstdc++ it is 32 bytes rather than 48; checked
+ * below), and keys that sit next to each other in memory.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "double_hashing.h"
+
+static_assert(HashTableDouble<std::string_view>::SlotBytes() <
+                  HashTableDouble<std::string>::SlotBytes(),
+              "std::string_view keys should make smaller slots than std::string ones");
+#if defined(__GLIBCXX__) && SIZE_MAX == UINT64_MAX
+static_assert(HashTableDouble<std::string_view>::SlotBytes() == 32 &&
+                  HashTableDouble<std::string>::SlotBytes() == 48,
+              "slot sizes quoted above are out of date");
+#endif
+
+class StringArena
+{
+public:
+  /**
+   * @brief Construct a new String Arena object
+   *
+   * @param block_size bytes per block; longer strings get a block of their own
+   */
+  explicit StringArena(size_t block_size = 64 * 1024) : block_size_{block_size} {}
+
+  /**
+   * @brief copies s into the arena. The returned view stays valid until
+   *        Clear() or the arena is destroyed; later stores never move it.
+   *
+   * @param s
+   * @return std::string_view
+   */
+  std::string_view Store(std::string_view s)
+  {
+    if (s.size() > remaining_)
+    {
+      size_t size = std::max(block_size_, s.size());
+      blocks_.emplace_back(new char[size]);
+      next_ = blocks_.back().get();
+      remaining_ = size;
+    }
+    std::memcpy(next_, s.data(), s.size());
+    std::string_view stored(next_, s.size());
+    next_ += s.size();
+    remaining_ -= s.size();
+    bytes_used_ += s.size();
+    return stored;
+  }
+
+  /**
+   * @brief gives back the space of stored if it was the most recent Store
+   *
+   * @param stored
+   */
+  void Rollback(std::string_view stored)
+  {
+    if (stored.data() + stored.size() == next_)
+    {
+      next_ -= stored.size();
+      remaining_ += stored.size();
+      bytes_used_ -= stored.size();
+    }
+  }
+
+  /**
+   * @brief frees every block
+   *
+   */
+  void Clear()
+  {
+    blocks_.clear();
+    next_ = nullptr;
+    remaining_ = 0;
+    bytes_used_ = 0;
+  }
+
+  /**
+   * @brief returns the number of string bytes stored
+   *
+   * @return size_t
+   */
+  size_t BytesUsed() const
+  {
+    return bytes_used_;
+  }
+
+  /**
+   * @brief returns the number of heap blocks the arena holds
+   *
+   * @return size_t
+   */
+  size_t BlockCount() const
+  {
+    return blocks_.size();
+  }
+
+private:
+  size_t block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char *next_ = nullptr;
+  size_t remaining_ = 0;
+  size_t bytes_used_ = 0;
+};
+
+template <typename Table = HashTableDouble<std::string_view>>
+class ArenaStringTable
+{
+public:
+  /**
+   * @brief Construct a new Arena String Table object; args go to Table's
+   *        constructor
+   *
+   * @param args
+   */
+  template <typename... Args>
+  explicit ArenaStringTable(Args &&...args) : table_(std::forward<Args>(args)...) {}
+
+  ArenaStringTable(const ArenaStringTable &) = delete;
+  ArenaStringTable &operator=(const ArenaStringTable &) = delete;
+
+  /**
+   * @brief deletes all entries and frees the arena
+   *
+   */
+  void MakeEmpty()
+  {
+    table_.MakeEmpty();
+    arena_.Clear();
+  }
+
+  /**
+   * @brief size the table once so that n keys fit without further rehashing
+   *
+   * @param n
+   */
+  void Reserve(size_t n)
+  {
+    table_.Reserve(n);
+  }
+
+  /**
+   * @brief copy x into the arena and insert it; the copy is undone if x was
+   *        already present
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Insert(std::string_view x)
+  {
+    std::string_view stored = arena_.Store(x);
+    if (table_.Insert(stored))
+      return true;
+    arena_.Rollback(stored);
+    return false;
+  }
+
+  /**
+   * @brief look up x without throwing
+   *
+   * @param x
+   * @return Table::LookupResult
+   */
+  typename Table::LookupResult Find(std::string_view x) const
+  {
+    return table_.Find(x);
+  }
+
+  /**
+   * @brief look up every key in [first, last), writing one LookupResult per
+   *        key to results; see Table::FindBatch
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    return table_.FindBatch(first, last, results);
+  }
+
+  /**
+   * @brief return how many probes it took to find x, otherwise throw
+   *
+   * @param x
+   * @return int
+   */
+  int Get(std::string_view x)
+  {
+    return table_.Get(x);
+  }
+
+  /**
+   * @brief remove x from the table. Its bytes stay in the arena until
+   *        MakeEmpty().
+   *
+   * @param x
+   * @return true
+   * @return false
+   */
+  bool Remove(std::string_view x)
+  {
+    return table_.Remove(x);
+  }
+
+  /**
+   * @brief return total collisions that occured while probing
+   *
+   * @return int
+   */
+  int TotalCollisions()
+  {
+    return table_.TotalCollisions();
+  }
+
+  /**
+   * @brief returns total elements in HashTable
+   *
+   * @return int
+   */
+  int TotalElements()
+  {
+    return table_.TotalElements();
+  }
+
+  /**
+   * @brief returns internal HashTable allocated size
+   *
+   * @return int
+   */
+  int InternalSize()
+  {
+    return table_.InternalSize();
+  }
+
+  /**
+   * @brief returns the table's health statistics; bytes_used also counts
+   *        the key bytes held in the arena
+   *
+   * @return TableStats
+   */
+  TableStats Stats() const
+  {
+    TableStats stats = table_.Stats();
+    stats.bytes_used += arena_.BytesUsed();
+    return stats;
+  }
+
+  /**
+   * @brief returns the arena holding the keys
+   *
+   * @return const StringArena&
+   */
+  const StringArena &Arena() const
+  {
+    return arena_;
+  }
+
+private:
+  StringArena arena_;
+  Table table_;
+};
+
+#endif // STRING_ARENA_H
@@ -0,0 +1,178 @@
+/**
+ * @file string_hashers.h
+ * @author Moududur Rahman
+ * @brief Fast non-cryptographic string hash functions usable as the Hasher
+ *        template parameter of the hash tables
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * std::hash<std::string> differs between standard libraries in both speed
+ * and quality. These hashers give the tables a fixed, known function:
+ *
+ *  - Fnv1aHash: byte-at-a-time FNV-1a, tiny and decent on short words
+ *  - WyHash: wyhash (final version), which reads 4 or 8 bytes at a time and
+ *    mixes with 64x64->128 bit multiplies
+ *
+ * Both take a std::string_view, so a std::string and a view of the same
+ * characters hash alike and string tables can be searched by view.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef STRING_HASHERS_H
+#define STRING_HASHERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+struct Fnv1aHash
+{
+  /**
+   * @brief returns the 64-bit FNV-1a hash of len bytes at data
+   *
+   * @param data
+   * @param len
+   * @return size_t
+   */
+  size_t operator()(const char *data, size_t len) const
+  {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (size_t i = 0; i < len; i++)
+    {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= UINT64_C(1099511628211);
+    }
+    return static_cast<size_t>(hash);
+  }
+
+  size_t operator()(std::string_view s) const
+  {
+    return (*this)(s.data(), s.size());
+  }
+};
+
+struct WyHash
+{
+  /**
+   * @brief returns the wyhash of len bytes at data
+   *
+   * @param data
+   * @param len
+   * @return size_t
+   */
+  size_t operator()(const char *data, size_t len) const
+  {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    uint64_t seed = Mix(kSecret0, kSecret1);
+    uint64_t a, b;
+    if (len <= 16)
+    {
+      if (len >= 4)
+      {
+        size_t skip = (len >> 3) << 2;
+        a = (Read4(p) << 32) | Read4(p + skip);
+        b = (Read4(p + len - 4) << 32) | Read4(p + len - 4 - skip);
+      }
+      else if (len > 0)
+      {
+        a = (static_cast<uint64_t>(p[0]) << 16) |
+            (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+        b = 0;
+      }
+      else
+      {
+        a = b = 0;
+      }
+    }
+    else
+    {
+      size_t i = len;
+      if (i > 48)
+      {
+        uint64_t see1 = seed, see2 = seed;
+        do
+        {
+          seed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ seed);
+          see1 = Mix(Read8(p + 16) ^ kSecret2, Read8(p + 24) ^ see1);
+          see2 = Mix(Read8(p + 32) ^ kSecret3, Read8(p + 40) ^ see2);
+          p += 48;
+          i -= 48;
+        } while (i > 48);
+        seed ^= see1 ^ see2;
+      }
+      while (i > 16)
+      {
+        seed = Mix(Read8(p) ^ kSecret1, Read8(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+      }
+      a = Read8(p + i - 16);
+      b = Read8(p + i - 8);
+    }
+    a ^= kSecret1;
+    b ^= seed;
+    Multiply(a, b);
+    return static_cast<size_t>(Mix(a ^ kSecret0 ^ len, b ^ kSecret1));
+  }
+
+  size_t operator()(std::string_view s) const
+  {
+    return (*this)(s.data(), s.size());
+  }
+
+private:
+  static const uint64_t kSecret0 = UINT64_C(0x2d358dccaa6c78a5);
+  static const uint64_t kSecret1 = UINT64_C(0x8bb84b93962eacc9);
+  static const uint64_t kSecret2 = UINT64_C(0x4b33a62ed433d4a3);
+  static const uint64_t kSecret3 = UINT64_C(0x4d5a2da51de1aa47);
+
+  /**
+   * @brief replaces a and b with the low and high halves of a * b
+   *
+   * @param a
+   * @param b
+   */
+  static void Multiply(uint64_t &a, uint64_t &b)
+  {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffff, lb = b & 0xffffffff;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+  }
+
+  static uint64_t Mix(uint64_t a, uint64_t b)
+  {
+    Multiply(a, b);
+    return a ^ b;
+  }
+
+  static uint64_t Read8(const unsigned char *p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+  }
+
+  static uint64_t Read4(const unsigned char *p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+  }
+};
+
+#endif // STRING_HASHERS_H
@@ -0,0 +1,236 @@
+/**
+ * @file suggestion_index.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for
+ *        SuggestionIndex, a symmetric-delete index of spelling corrections
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Two words are within edit distance d of each other only if deleting at most
+ * d letters from each makes them equal. The index is built by deleting up to
+ * max_distance letters from every dictionary word in every way and recording
+ * which word each variant came from. A misspelled word is then looked up by
+ * generating only its own delete variants, a few dozen at most, instead of
+ * every insertion, deletion and swap; each word found is confirmed with
+ * EditDistance.
+ *
+ * Variants are kept as (32-bit hash, word id) pairs grouped into buckets by
+ * the top bits of the hash, with a directory of where each bucket starts, so
+ * a lookup is one directory read and a scan of about two entries. Hash
+ * collisions only cost an extra EditDistance.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef SUGGESTION_INDEX_H
+#define SUGGESTION_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "edit_distance.h"
+#include "string_arena.h"
+#include "string_hashers.h"
+
+class SuggestionIndex
+{
+public:
+  /**
+   * @brief Construct a new Suggestion Index object from the words in
+   *        [first, last)
+   *
+   * @param first
+   * @param last
+   * @param max_distance the largest edit distance Suggest can search
+   */
+  template <typename InputIt>
+  SuggestionIndex(InputIt first, InputIt last, int max_distance = 2)
+      : max_distance_{max_distance}
+  {
+    // (hash, word id) of every variant, grouped by word.
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    std::vector<std::string_view> variants;
+    std::vector<uint32_t> word_hashes;
+    for (; first != last; ++first)
+    {
+      uint32_t id = words_.size();
+      words_.push_back(arena_.Store(*first));
+      DeleteVariants(words_.back(), variants, max_distance_);
+      word_hashes.clear();
+      for (std::string_view variant : variants)
+        word_hashes.push_back(Hash(variant));
+      // The same variant can come from one word several ways ("book" less
+      // either 'o'); keep one entry for each.
+      std::sort(word_hashes.begin(), word_hashes.end());
+      word_hashes.erase(std::unique(word_hashes.begin(), word_hashes.end()), word_hashes.end());
+      for (uint32_t hash : word_hashes)
+        entries.emplace_back(hash, id);
+    }
+
+    // Distribute the entries into directory buckets of about two entries
+    // each with a counting sort, which beats a full sort by hash.
+    directory_bits_ = 1;
+    while (directory_bits_ < 24 && (size_t{2} << directory_bits_) < entries.size())
+      directory_bits_++;
+    directory_.assign((size_t{1} << directory_bits_) + 1, 0);
+    for (const auto &entry : entries)
+      directory_[Bucket(entry.first) + 1]++;
+    for (size_t bucket = 1; bucket < directory_.size(); bucket++)
+      directory_[bucket] += directory_[bucket - 1];
+
+    std::vector<uint32_t> next(directory_.begin(), directory_.end() - 1);
+    hashes_.resize(entries.size());
+    ids_.resize(entries.size());
+    for (const auto &entry : entries)
+    {
+      uint32_t pos = next[Bucket(entry.first)]++;
+      hashes_[pos] = entry.first;
+      ids_[pos] = entry.second;
+    }
+  }
+
+  SuggestionIndex(const SuggestionIndex &) = delete;
+  SuggestionIndex &operator=(const SuggestionIndex &) = delete;
+
+  /**
+   * @brief returns every dictionary word within max_distance edits of typo,
+   *        closest first
+   *
+   * @param typo
+   * @param max_distance capped at the distance the index was built for
+   * @return std::vector<Suggestion>
+   */
+  std::vector<Suggestion> Suggest(std::string_view typo, int max_distance = 2) const
+  {
+    max_distance = std::min(max_distance, max_distance_);
+    std::vector<std::string_view> variants;
+    DeleteVariants(typo, variants, max_distance);
+
+    std::vector<uint32_t> candidates;
+    for (std::string_view variant : variants)
+    {
+      uint32_t hash = Hash(variant);
+      size_t bucket = Bucket(hash);
+      for (uint32_t x = directory_[bucket]; x < directory_[bucket + 1]; x++)
+      {
+        if (hashes_[x] == hash)
+          candidates.push_back(ids_[x]);
+      }
+    }
+    // Ids follow dictionary order, so sorting them keeps the output stable.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<Suggestion> suggestions;
+    for (uint32_t id : candidates)
+    {
+      int distance = EditDistance(typo, words_[id], max_distance);
+      if (distance > max_distance || distance == 0)
+        continue;
+      char type = distance == 1 ? EditCase(typo, words_[id]) : 0;
+      suggestions.push_back(Suggestion{words_[id], distance, type});
+    }
+    SortSuggestions(suggestions);
+    return suggestions;
+  }
+
+  /**
+   * @brief returns the number of words indexed
+   *
+   * @return size_t
+   */
+  size_t TotalWords() const
+  {
+    return words_.size();
+  }
+
+  /**
+   * @brief returns the number of distinct (variant, word) pairs stored
+   *
+   * @return size_t
+   */
+  size_t TotalVariants() const
+  {
+    return ids_.size();
+  }
+
+private:
+  int max_distance_;
+  StringArena arena_;
+  std::vector<std::string_view> words_;
+  // Variant hashes grouped by bucket and, at the same index, the word each
+  // came from.
+  std::vector<uint32_t> hashes_;
+  std::vector<uint32_t> ids_;
+  // Bucket b holds entries [directory_[b], directory_[b + 1]).
+  std::vector<uint32_t> directory_;
+  unsigned directory_bits_ = 1;
+
+  /**
+   * @brief returns the directory bucket of a variant hash: its top bits
+   *
+   * @param hash
+   * @return size_t
+   */
+  size_t Bucket(uint32_t hash) const
+  {
+    return hash >> (32 - directory_bits_);
+  }
+
+  /**
+   * @brief fills variants with word and every string made by deleting up to
+   *        max_distance of its letters. The views point into a per-thread
+   *        buffer that the next call overwrites.
+   *
+   * @param word
+   * @param variants
+   * @param max_distance
+   */
+  static void DeleteVariants(std::string_view word, std::vector<std::string_view> &variants,
+                             int max_distance)
+  {
+    static thread_local std::string buffer, variant;
+    buffer.assign(word);
+    // (offset into buffer, length) of each variant.
+    std::vector<std::pair<size_t, size_t>> spans{{0, word.size()}};
+
+    // Each round deletes one more letter from every variant of the last
+    // round, starting past the previous deletion so that each set of
+    // positions is produced once.
+    std::vector<size_t> starts{0};
+    size_t round_begin = 0;
+    for (int round = 0; round < max_distance; round++)
+    {
+      size_t round_end = spans.size();
+      for (size_t v = round_begin; v < round_end; v++)
+      {
+        for (size_t x = starts[v]; x < spans[v].second; x++)
+        {
+          variant.assign(buffer, spans[v].first, spans[v].second);
+          variant.erase(x, 1);
+          spans.emplace_back(buffer.size(), variant.size());
+          buffer += variant;
+          starts.push_back(x);
+        }
+      }
+      round_begin = round_end;
+    }
+
+    variants.clear();
+    for (const auto &span : spans)
+      variants.emplace_back(buffer.data() + span.first, span.second);
+  }
+
+  static uint32_t Hash(std::string_view variant)
+  {
+    static WyHash hf;
+    return static_cast<uint32_t>(hf(variant.data(), variant.size()));
+  }
+};
+
+#endif // SUGGESTION_INDEX_H
@@ -0,0 +1,429 @@
+/**
+ * @file table_image.h
+ * @author Moududur Rahman
+ * @brief The header file containing inline implementation for TableImage,
+ *        a read-only hash table stored in a file and used in place via mmap
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * Building a dictionary table costs O(words) hashing and copying on every
+ * run. A table image is built once and written to disk; later runs map the
+ * file and probe it directly, so opening one costs little more than the page
+ * faults of the pages it touches.
+ *
+ * Layout (native byte order, every reference is an offset, so the image can
+ * be mapped at any address):
+ *
+ *   ImageHeader   magic, version, counts, source file stamp, checksum
+ *   ImageSlot[]   slot_count slots, linear probing, power-of-two count
+ *   char[]        string pool holding every word back to back
+ *
+ * Slots are placed with WyHash rather than std::hash, whose output is not
+ * guaranteed to be stable across standard library versions.
+ *
+ * Open only checks the header against the file size, so it touches one
+ * page; the checksum over the slots and pool is left to Verify, which reads
+ * all of them. Lookups check every slot they read against the pool and
+ * probe at most slot_count slots, so a corrupt image can give wrong answers
+ * but never reads outside the mapping.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef TABLE_IMAGE_H
+#define TABLE_IMAGE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prefetch.h"
+#include "size_policy.h"
+#include "string_hashers.h"
+
+class TableImage
+{
+public:
+  /**
+   * @brief outcome of a non-throwing lookup: whether the key was found and
+   *        how many probes it took either way
+   *
+   */
+  struct LookupResult
+  {
+    bool found;
+    int probes;
+
+    explicit operator bool() const
+    {
+      return found;
+    }
+  };
+
+  TableImage() = default;
+  TableImage(const TableImage &) = delete;
+  TableImage &operator=(const TableImage &) = delete;
+
+  /**
+   * @brief Destroy the Table Image object, unmapping its file
+   *
+   */
+  ~TableImage()
+  {
+    Close();
+  }
+
+  /**
+   * @brief builds an image holding every whitespace separated word of
+   *        dictionary_file and writes it to image_file
+   *
+   * @param dictionary_file
+   * @param image_file
+   * @return true
+   * @return false if either file could not be read or written
+   */
+  static bool Build(const std::string &dictionary_file, const std::string &image_file)
+  {
+    struct stat source;
+    std::ifstream in(dictionary_file);
+    if (!in || stat(dictionary_file.c_str(), &source) != 0)
+      return false;
+
+    std::vector<std::string> words;
+    std::string line;
+    while (in >> line)
+      words.push_back(line);
+
+    PowerOfTwoSizePolicy policy;
+    std::vector<ImageSlot> slots(policy.Resize(2 * words.size() + 1), ImageSlot{0, 0, 0});
+    std::string pool;
+    size_t word_count = 0;
+    WyHash hf;
+    for (const std::string &word : words)
+    {
+      uint64_t hash = hf(word);
+      size_t current_pos = policy.Index(hash);
+      bool duplicate = false;
+      while (slots[current_pos].length != 0)
+      {
+        const ImageSlot &slot = slots[current_pos];
+        if (slot.hash == hash && pool.compare(slot.offset, slot.length, word) == 0)
+        {
+          duplicate = true;
+          break;
+        }
+        current_pos = (current_pos + 1) & (slots.size() - 1);
+      }
+      if (duplicate)
+        continue;
+      slots[current_pos] = ImageSlot{static_cast<uint32_t>(pool.size()),
+                                     static_cast<uint32_t>(word.size()), hash};
+      pool += word;
+      word_count++;
+    }
+
+    ImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.slot_count = slots.size();
+    header.word_count = word_count;
+    header.pool_size = pool.size();
+    header.source_size = source.st_size;
+    header.source_mtime = source.st_mtime;
+    header.checksum = Checksum(reinterpret_cast<const char *>(slots.data()),
+                               slots.size() * sizeof(ImageSlot), pool.data(), pool.size());
+
+    // Write next to the target and rename, so a reader never maps a
+    // half-written image.
+    const std::string temp_file = image_file + ".tmp";
+    {
+      std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      out.write(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(ImageSlot));
+      out.write(pool.data(), pool.size());
+      if (!out)
+        return false;
+    }
+    return std::rename(temp_file.c_str(), image_file.c_str()) == 0;
+  }
+
+  /**
+   * @brief maps image_file and validates its header against the file size.
+   *        Returns false, leaving the image closed, if any check fails. The
+   *        slots and pool are not read; see Verify.
+   *
+   * @param image_file
+   * @return true
+   * @return false
+   */
+  bool Open(const std::string &image_file)
+  {
+    Close();
+    int fd = open(image_file.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ImageHeader))
+    {
+      void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED)
+      {
+        data_ = static_cast<const char *>(mapping);
+        size_ = info.st_size;
+      }
+    }
+    close(fd);
+    if (data_ == nullptr)
+      return false;
+
+    header_ = reinterpret_cast<const ImageHeader *>(data_);
+    size_t slot_bytes = header_->slot_count * sizeof(ImageSlot);
+    bool valid = std::memcmp(header_->magic, kMagic, sizeof(header_->magic)) == 0 &&
+                 header_->version == kVersion &&
+                 header_->slot_count != 0 &&
+                 (header_->slot_count & (header_->slot_count - 1)) == 0 &&
+                 header_->slot_count <= size_ / sizeof(ImageSlot) &&
+                 header_->pool_size <= size_ &&
+                 size_ == sizeof(ImageHeader) + slot_bytes + header_->pool_size;
+    if (!valid)
+    {
+      Close();
+      return false;
+    }
+    slots_ = reinterpret_cast<const ImageSlot *>(data_ + sizeof(ImageHeader));
+    pool_ = data_ + sizeof(ImageHeader) + slot_bytes;
+    policy_.Resize(header_->slot_count);
+    return true;
+  }
+
+  /**
+   * @brief returns if the open image's slots and pool match the checksum
+   *        it was built with. This reads, and so faults in, the whole image.
+   *
+   * @return true
+   * @return false
+   */
+  bool Verify() const
+  {
+    return IsOpen() &&
+           Checksum(reinterpret_cast<const char *>(slots_),
+                    header_->slot_count * sizeof(ImageSlot),
+                    pool_, header_->pool_size) == header_->checksum;
+  }
+
+  /**
+   * @brief returns if the image was built from dictionary_file as it is now,
+   *        judged by its size and modification time
+   *
+   * @param dictionary_file
+   * @return true
+   * @return false
+   */
+  bool MatchesSource(const std::string &dictionary_file) const
+  {
+    struct stat source;
+    return IsOpen() && stat(dictionary_file.c_str(), &source) == 0 &&
+           header_->source_size == static_cast<uint64_t>(source.st_size) &&
+           header_->source_mtime == static_cast<int64_t>(source.st_mtime);
+  }
+
+  /**
+   * @brief unmaps the image, if one is open
+   *
+   */
+  void Close()
+  {
+    if (data_ != nullptr)
+      munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+    slots_ = nullptr;
+    pool_ = nullptr;
+  }
+
+  /**
+   * @brief returns if an image is mapped
+   *
+   * @return true
+   * @return false
+   */
+  bool IsOpen() const
+  {
+    return data_ != nullptr;
+  }
+
+  /**
+   * @brief look up word without throwing
+   *
+   * @param word
+   * @return LookupResult
+   */
+  LookupResult Find(std::string_view word) const
+  {
+    return Find(word, Hash(word));
+  }
+
+  /**
+   * @brief look up every word in [first, last), writing one LookupResult per
+   *        word to results. Each batch of words is hashed and has its home
+   *        slots prefetched before any of them is probed.
+   *
+   * @param first
+   * @param last
+   * @param results
+   * @return OutputIt past the last result written
+   */
+  template <typename ForwardIt, typename OutputIt>
+  OutputIt FindBatch(ForwardIt first, ForwardIt last, OutputIt results) const
+  {
+    uint64_t hashes[kPrefetchBatch];
+    while (first != last)
+    {
+      ForwardIt batch = first;
+      size_t count = 0;
+      for (; first != last && count < kPrefetchBatch; ++first, ++count)
+      {
+        hashes[count] = Hash(*first);
+        Prefetch(&slots_[policy_.Index(hashes[count])]);
+      }
+      for (size_t x = 0; x < count; ++x, ++batch)
+        *results++ = Find(*batch, hashes[x]);
+    }
+    return results;
+  }
+
+  /**
+   * @brief returns the number of distinct words in the image
+   *
+   * @return int
+   */
+  int TotalElements() const
+  {
+    return header_->word_count;
+  }
+
+  /**
+   * @brief returns the number of slots in the image
+   *
+   * @return int
+   */
+  int InternalSize() const
+  {
+    return header_->slot_count;
+  }
+
+private:
+  static constexpr char kMagic[8] = {'D', 'S', 'A', 'H', 'T', 'I', 'M', 'G'};
+  static const uint32_t kVersion = 1;
+
+  /**
+   * @brief fixed-size header at the start of an image
+   *
+   */
+  struct ImageHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t slot_count;
+    uint64_t word_count;
+    uint64_t pool_size;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t checksum;
+  };
+
+  /**
+   * @brief one slot: where the word sits in the pool and its full hash. An
+   *        empty slot has length 0.
+   *
+   */
+  struct ImageSlot
+  {
+    uint32_t offset;
+    uint32_t length;
+    uint64_t hash;
+  };
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  const ImageHeader *header_ = nullptr;
+  const ImageSlot *slots_ = nullptr;
+  const char *pool_ = nullptr;
+  PowerOfTwoSizePolicy policy_;
+
+  static uint64_t Hash(std::string_view word)
+  {
+    static WyHash hf;
+    return hf(word.data(), word.size());
+  }
+
+  /**
+   * @brief Find for a caller that already has hash == Hash(word)
+   *
+   * @param word
+   * @param hash
+   * @return LookupResult
+   */
+  LookupResult Find(std::string_view word, uint64_t hash) const
+  {
+    size_t mask = header_->slot_count - 1;
+    size_t current_pos = policy_.Index(hash);
+    int probes = 1;
+    // A sound image always has an empty slot; a corrupt one may not.
+    for (size_t x = 0; x < header_->slot_count && slots_[current_pos].length != 0; x++)
+    {
+      const ImageSlot &slot = slots_[current_pos];
+      if (slot.hash == hash && InPool(slot) &&
+          std::string_view(pool_ + slot.offset, slot.length) == word)
+        return LookupResult{true, probes};
+      probes++;
+      current_pos = (current_pos + 1) & mask;
+    }
+    return LookupResult{false, probes};
+  }
+
+  /**
+   * @brief returns if slot's word lies within the pool
+   *
+   * @param slot
+   * @return true
+   * @return false
+   */
+  bool InPool(const ImageSlot &slot) const
+  {
+    return slot.offset <= header_->pool_size &&
+           slot.length <= header_->pool_size - slot.offset;
+  }
+
+  /**
+   * @brief returns a checksum of the slot array and the pool
+   *
+   * @param slots
+   * @param slot_bytes
+   * @param pool
+   * @param pool_size
+   * @return uint64_t
+   */
+  static uint64_t Checksum(const char *slots, size_t slot_bytes,
+                           const char *pool, size_t pool_size)
+  {
+    WyHash hf;
+    return hf(slots, slot_bytes) ^ (hf(pool, pool_size) * UINT64_C(31));
+  }
+};
+
+#endif // TABLE_IMAGE_H
@@ -0,0 +1,256 @@
+/**
+ * @file table_stats.h
+ * @author Moududur Rahman
+ * @brief Health statistics the hash tables report through Stats()
+ * @version 0.1
+ * @date 2021-11-01
+ *
+ * TotalCollisions adds the probes of every insert and Get into one number.
+ * TableStats breaks that down instead: one probe-length histogram each for
+ * inserts, Gets that found their key and Gets that did not; the lengths of
+ * the runs of occupied slots that probes have to cross; and the tombstones,
+ * rehashes and memory behind the table.
+ *
+ * The histograms are recorded by the modifying operations only. Find,
+ * FindBatch and Contains write nothing, so that any number of threads may
+ * call them at once, and are not recorded, just as they are left out of
+ * TotalCollisions.
+ *
+ * @copyright Copyright (c) 2021
+ *
+ */
+
+#ifndef TABLE_STATS_H
+#define TABLE_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief counts of how often each length (of a probe sequence or a cluster)
+ *        occurred
+ *
+ */
+class Histogram
+{
+public:
+  /**
+   * @brief records one occurrence of length
+   *
+   * @param length
+   */
+  void Add(size_t length)
+  {
+    if (length >= counts_.size())
+      counts_.resize(length + 1);
+    counts_[length]++;
+  }
+
+  /**
+   * @brief returns counts, where counts[n] is how often length n occurred
+   *
+   * @return const std::vector<uint64_t>&
+   */
+  const std::vector<uint64_t> &Counts() const
+  {
+    return counts_;
+  }
+
+  /**
+   * @brief returns the number of lengths recorded
+   *
+   * @return uint64_t
+   */
+  uint64_t Total() const
+  {
+    uint64_t total = 0;
+    for (uint64_t count : counts_)
+      total += count;
+    return total;
+  }
+
+  /**
+   * @brief returns the mean length, or 0 if none was recorded
+   *
+   * @return double
+   */
+  double Mean() const
+  {
+    uint64_t total = Total();
+    if (total == 0)
+      return 0;
+    double sum = 0;
+    for (size_t length = 0; length < counts_.size(); length++)
+      sum += static_cast<double>(length) * counts_[length];
+    return sum / total;
+  }
+
+  /**
+   * @brief returns the longest length recorded, or 0 if none was
+   *
+   * @return size_t
+   */
+  size_t Max() const
+  {
+    for (size_t length = counts_.size(); length > 0; length--)
+    {
+      if (counts_[length - 1] != 0)
+        return length - 1;
+    }
+    return 0;
+  }
+
+  /**
+   * @brief returns the shortest length that at least fraction of the
+   *        recorded lengths do not exceed, e.g. 0.99 for the p99
+   *
+   * @param fraction
+   * @return size_t
+   */
+  size_t Percentile(double fraction) const
+  {
+    uint64_t total = Total();
+    uint64_t seen = 0;
+    for (size_t length = 0; length < counts_.size(); length++)
+    {
+      seen += counts_[length];
+      if (seen > 0 && seen >= fraction * total)
+        return length;
+    }
+    return 0;
+  }
+
+  /**
+   * @brief writes the histogram as a JSON object
+   *
+   * @param out
+   */
+  void WriteJson(std::ostream &out) const
+  {
+    out << "{\"count\":" << Total() << ",\"mean\":" << Mean() << ",\"max\":" << Max()
+        << ",\"p99\":" << Percentile(0.99) << ",\"histogram\":[";
+    for (size_t length = 0; length < counts_.size(); length++)
+      out << (length == 0 ? "" : ",") << counts_[length];
+    out << "]}";
+  }
+
+private:
+  std::vector<uint64_t> counts_;
+};
+
+/**
+ * @brief a snapshot of one table's health. Probe lengths count slots
+ *        examined, except in HashTableSwiss, where they count groups.
+ *
+ */
+struct TableStats
+{
+  Histogram insert_probes;
+  Histogram hit_probes;
+  Histogram miss_probes;
+  // Elements each insert evicted to make room; only HashTableCuckoo evicts.
+  Histogram displacements;
+  // Lengths of the runs of consecutive non-empty slots (live or deleted).
+  Histogram cluster_sizes;
+  size_t elements = 0;
+  size_t slots = 0;
+  size_t tombstones = 0;
+  size_t rehash_count = 0;
+  double rehash_ms = 0;
+  // Memory held by the slot arrays; memory the elements own is not counted.
+  size_t bytes_used = 0;
+
+  /**
+   * @brief writes the stats as a JSON object
+   *
+   * @param out
+   */
+  void WriteJson(std::ostream &out) const
+  {
+    out << "{\"elements\":" << elements << ",\"slots\":" << slots
+        << ",\"load_factor\":" << (slots == 0 ? 0 : elements / static_cast<double>(slots))
+        << ",\"tombstones\":" << tombstones << ",\"rehash_count\":" << rehash_count
+        << ",\"rehash_ms\":" << rehash_ms << ",\"bytes_used\":" << bytes_used;
+    out << ",\"insert_probes\":";
+    insert_probes.WriteJson(out);
+    out << ",\"hit_probes\":";
+    hit_probes.WriteJson(out);
+    out << ",\"miss_probes\":";
+    miss_probes.WriteJson(out);
+    out << ",\"displacements\":";
+    displacements.WriteJson(out);
+    out << ",\"cluster_sizes\":";
+    cluster_sizes.WriteJson(out);
+    out << "}";
+  }
+};
+
+/**
+ * @brief returns the lengths of the runs of slots for which occupied(slot)
+ *        holds, in a table of slot_count slots that wraps around
+ *
+ * @param slot_count
+ * @param occupied
+ * @return Histogram
+ */
+template <typename IsOccupied>
+Histogram ClusterSizes(size_t slot_count, IsOccupied occupied)
+{
+  Histogram clusters;
+  // Start just after an empty slot, so no run is split by the wrap-around.
+  size_t start = 0;
+  while (start < slot_count && occupied(start))
+    start++;
+  if (start == slot_count)
+  {
+    if (slot_count != 0)
+      clusters.Add(slot_count);
+    return clusters;
+  }
+
+  size_t run = 0;
+  for (size_t x = 1; x <= slot_count; x++)
+  {
+    size_t slot = (start + x) % slot_count;
+    if (occupied(slot))
+    {
+      run++;
+    }
+    else if (run != 0)
+    {
+      clusters.Add(run);
+      run = 0;
+    }
+  }
+  return clusters;
+}
+
+/**
+ * @brief counts one rehash into stats, timing it from construction to
+ *        destruction
+ *
+ */
+class RehashTimer
+{
+public:
+  explicit RehashTimer(TableStats &stats)
+      : stats_{stats}, start_{std::chrono::steady_clock::now()}
+  {
+  }
+
+  ~RehashTimer()
+  {
+    stats_.rehash_count++;
+    stats_.rehash_ms += std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start_)
+                            .count();
+  }
+
+private:
+  TableStats &stats_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif // TABLE_STATS_H